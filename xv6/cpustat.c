@@ -0,0 +1,32 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+
+// print per-CPU idle time and reschedule IPI wake-up latency
+int
+main(int argc, char *argv[])
+{
+  struct cpustat st[NCPU];
+  int i, n;
+
+  n = cpustat(st, NCPU);
+  if(n < 0){
+    printf(2, "cpustat: failed\n");
+    exit();
+  }
+
+  printf(1, "cpu  halts     ipis_sent ipis_recv idle_cycles          avg_wake    max_wake    promotions  boosts\n");
+  for(i = 0; i < n; i++){
+    printf(1, "%d    %d        %d        %d        %l          ",
+           i, st[i].halts, st[i].ipis_sent, st[i].ipis_received, st[i].idle_cycles);
+    if(st[i].ipis_received > 0)
+      printf(1, "%d", (uint)st[i].wake_cycles / st[i].ipis_received);
+    else
+      printf(1, "-");
+    printf(1, "           %l          %d          %d\n", st[i].max_wake_cycles,
+           st[i].promotions, st[i].boosts);
+  }
+  exit();
+}
@@ -1,5 +1,11 @@
 struct buf;
 struct context;
+struct cpustat;
+struct sched_param;
+struct procstat;
+struct procinfo;
+struct lockstat;
+struct sysstat;
 struct file;
 struct inode;
 struct pipe;
@@ -73,12 +79,17 @@ void            kinit2(void*, void*);
 // kbd.c
 void            kbdintr(void);
 
+// kinfo.c
+void            kinfo_tick(uint);
+void            kinfo_switch(struct proc*);
+
 // lapic.c
 void            cmostime(struct rtcdate *r);
 int             lapicid(void);
 extern volatile uint*    lapic;
 void            lapiceoi(void);
 void            lapicinit(void);
+void            lapicipi(uchar, int);
 void            lapicstartap(uchar, uint);
 void            microdelay(int);
 
@@ -110,6 +121,7 @@ int             fork(void);
 int             growproc(int);
 int             kill(int);
 struct cpu*     mycpu(void);
+struct cpu*     lapiccpu(void);
 struct proc*    myproc();
 void            pinit(void);
 void            procdump(void);
@@ -119,20 +131,35 @@ void            setproc(struct proc*);
 void            sleep(void*, struct spinlock*);
 void            userinit(void);
 int             wait(void);
+int             waitpid(int);
 void            wakeup(void*);
+void            wakeup_one(void*);
 void            yield(void);
+void            sched_tick(void);
+int             set_quantum(int, int, int);
 int             find_largest_prime_factor(int);
 int             get_parent_pid();
-void            push_pid_in_stack(int,int);
-void            get_callers(int);
 void            set_proc_queue(int, int);
 void			set_lottery_params(int, int);
 void            set_a_proc_bjf_params(int, int, int, int);
 void            set_all_bjf_params(int, int, int);
 void            print_all_procs(void);
-void            sem_init(int, int);
-void            sem_acquire(int);
-void            sem_release(int);
+int             cpustat(struct cpustat*, int);
+void            aging_tick(void);
+int             set_starving_threshold(int);
+int             set_sched_params(struct sched_param*, int);
+int             set_affinity(int, uint);
+int             get_affinity(int);
+int             set_deadline(int, int, int);
+int             clone(void (*)(void*), void*, void*);
+int             join(void**);
+int             set_inheritance(int);
+void            pi_boost(int, int, int);
+void            pi_restore(int);
+int             futex_wait(uint*, uint);
+int             futex_wake(uint*, int);
+int             procstat(struct procstat*, int);
+int             getprocs(struct procinfo*, int);
 
 // swtch.S
 void            swtch(struct context**, struct context*);
@@ -145,6 +172,19 @@ void            initlock(struct spinlock*, char*);
 void            release(struct spinlock*);
 void            pushcli(void);
 void            popcli(void);
+int             lockbench(int);
+int             lockstat(struct lockstat*, int, int);
+
+// sem.c
+void            seminit(void);
+int             sem_open(char*, int);
+int             sem_close(int);
+int             sem_init(int, int);
+int             sem_acquire(int);
+int             sem_tryacquire(int);
+int             sem_timedacquire(int, int);
+int             sem_release(int);
+void            sem_tick(void);
 
 // sleeplock.c
 void            acquiresleep(struct sleeplock*);
@@ -174,10 +214,19 @@ void            timerinit(void);
 
 // trap.c
 void            idtinit(void);
+void            sysenterinit(void);
 extern uint     ticks;
 void            tvinit(void);
 extern struct spinlock tickslock;
 
+// trace.c
+int             set_tracing(int);
+void            trace_syscall(int, int, int);
+void            get_callers(int);
+int             set_sysstat(int);
+void            sysstat_record(int, uint64);
+int             sysstat(struct sysstat*, int);
+
 // uart.c
 void            uartinit(void);
 void            uartintr(void);
@@ -191,6 +240,7 @@ char*           uva2ka(pde_t*, char*);
 int             allocuvm(pde_t*, uint, uint);
 int             deallocuvm(pde_t*, uint, uint);
 void            freevm(pde_t*);
+int             mapkinfo(pde_t*, struct proc*);
 void            inituvm(pde_t*, char*, uint);
 int             loaduvm(pde_t*, char*, struct inode*, uint, uint);
 pde_t*          copyuvm(pde_t*, uint);
@@ -2,6 +2,7 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "defs.h"
 #include "x86.h"
@@ -19,6 +20,10 @@ exec(char *path, char **argv)
   pde_t *pgdir, *oldpgdir;
   struct proc *curproc = myproc();
 
+  // The other threads would be left running in the old image.
+  if(curproc->leader->nthreads > 0)
+    return -1;
+
   begin_op();
 
   if((ip = namei(path)) == 0){
@@ -37,6 +42,8 @@ exec(char *path, char **argv)
 
   if((pgdir = setupkvm()) == 0)
     goto bad;
+  if(mapkinfo(pgdir, curproc) < 0)
+    goto bad;
 
   // Load program into memory.
   sz = 0;
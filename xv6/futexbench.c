@@ -0,0 +1,78 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "uthread.h"
+
+#define MAXTHREAD 8
+#define ITERS 100000
+#define SEM 0  // kernel semaphore used for comparison
+
+// usage: futexbench [nthreads [iterations]]
+// Times a lock-protected counter increment, first in one
+// thread and then in nthreads threads at once, using a
+// futex mutex and then a kernel semaphore. Prints the ticks
+// each took and checks the count.
+static struct mutex m;
+static int iters, useksem;
+static volatile int counter;
+
+static void
+work(void *arg)
+{
+  int i;
+
+  for(i = 0; i < iters; i++){
+    if(useksem){
+      sem_acquire(SEM);
+      counter++;
+      sem_release(SEM);
+    } else {
+      mutex_lock(&m);
+      counter++;
+      mutex_unlock(&m);
+    }
+  }
+}
+
+static void
+run(char *name, int nthread)
+{
+  int i, start, elapsed;
+
+  counter = 0;
+  start = uptime();
+  for(i = 1; i < nthread; i++)
+    if(thread_create(work, 0) < 0){
+      printf(2, "futexbench: thread_create failed\n");
+      exit();
+    }
+  work(0);
+  while(thread_join() >= 0)
+    ;
+  elapsed = uptime() - start;
+  printf(1, "%s, %d threads: %d ticks", name, nthread, elapsed);
+  if(counter != nthread * iters)
+    printf(1, ", count %d, expected %d", counter, nthread * iters);
+  printf(1, "\n");
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nthread;
+
+  nthread = argc > 1 ? atoi(argv[1]) : 4;
+  iters = argc > 2 ? atoi(argv[2]) : ITERS;
+  if(nthread <= 0 || nthread > MAXTHREAD || iters <= 0){
+    printf(2, "usage: futexbench [nthreads [iterations]]\n");
+    exit();
+  }
+
+  mutex_init(&m);
+  sem_init(SEM, 1);
+  for(useksem = 0; useksem <= 1; useksem++){
+    run(useksem ? "sem_acquire" : "futex mutex", 1);
+    run(useksem ? "sem_acquire" : "futex mutex", nthread);
+  }
+  exit();
+}
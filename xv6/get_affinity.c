@@ -0,0 +1,22 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+// usage: get_affinity pid
+int
+main(int argc, char *argv[])
+{
+  int mask;
+
+  if(argc != 2){
+    printf(2, "usage: get_affinity pid\n");
+    exit();
+  }
+  if((mask = get_affinity(atoi(argv[1]))) < 0)
+    printf(2, "get_affinity: no process %s\n", argv[1]);
+  else
+    printf(1, "%d\n", mask);
+
+  exit();
+}
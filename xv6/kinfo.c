@@ -0,0 +1,60 @@
+// The kernel info pages of kinfo.h. The shared page lives in
+// the kernel's data; each process's own page is allocated by
+// mapkinfo() in vm.c and freed with the process.
+//
+// CPU 0 updates the shared page on each timer tick. Readers
+// retry if they see seq odd or changed, as kinfo_read() in
+// ulib.c does.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "kinfo.h"
+
+#define CALIB_START 10  // tick at which TSC calibration starts
+#define CALIB_TICKS 10  // and how many ticks it runs for
+
+static char page[PGSIZE] __attribute__((aligned(PGSIZE)));
+struct kinfo *kinfo = (struct kinfo*)page;
+
+static uint64 calib_tsc;
+
+// Called by the timer interrupt on CPU 0 after ticks changes.
+void
+kinfo_tick(uint t)
+{
+  uint64 tsc = rdtsc();
+
+  if(t == CALIB_START)
+    calib_tsc = tsc;
+  else if(t == CALIB_START + CALIB_TICKS)
+    kinfo->tsc_per_tick = (uint)((tsc - calib_tsc) / CALIB_TICKS);
+
+  kinfo->seq++;
+  kinfo->ticks = t;
+  kinfo->tsc = tsc;
+  kinfo->seq++;
+}
+
+// Called by the scheduler as it switches to p on this CPU.
+// nthreads is read without wait_lock: it only goes from 0 to
+// 1 in clone() run by p itself, which also clears the page.
+void
+kinfo_switch(struct proc *p)
+{
+  struct pkinfo *pk = p->leader->pkinfo;
+
+  if(pk == 0)
+    return;
+  if(p == p->leader && p->nthreads == 0){
+    pk->pid = p->pid;
+    pk->cpu = cpuid();
+  } else {
+    pk->pid = 0;
+    pk->cpu = -1;
+  }
+}
@@ -0,0 +1,21 @@
+// Kernel info pages, mapped read-only at the top of every
+// process's address space, just below KERNBASE, so that user
+// code can read these values without entering the kernel.
+// Only the kernel writes them (see kinfo.c).
+#define KINFO   0x7FFFE000  // struct kinfo, shared by all processes
+#define PKINFO  0x7FFFF000  // struct pkinfo, this process's own
+
+struct kinfo {
+  volatile uint seq;           // odd while the kernel is updating
+  volatile uint ticks;         // as returned by uptime()
+  volatile uint64 tsc;         // TSC when ticks last changed
+  volatile uint tsc_per_tick;  // TSC calibration, or 0 until done
+};
+
+// Written when a process is switched in. A process with
+// threads shares one page among them, so it holds pid 0
+// and cpu -1 instead, and getpid() asks the kernel.
+struct pkinfo {
+  volatile int pid;
+  volatile int cpu;            // CPU it is running on
+};
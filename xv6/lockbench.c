@@ -0,0 +1,37 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "x86.h"
+
+#define N 100000
+
+// usage: lockbench [iterations]
+// Prints the average cost, in TSC cycles, of an uncontended
+// acquire/release pair in the kernel and of a round trip
+// through a trivial system call.
+int
+main(int argc, char *argv[])
+{
+  uint64 t0, t1;
+  int i, n, c;
+
+  n = argc > 1 ? atoi(argv[1]) : N;
+  if(n <= 0 || n > 1000000){
+    printf(2, "usage: lockbench [iterations <= 1000000]\n");
+    exit();
+  }
+
+  if((c = lockbench(n)) < 0){
+    printf(2, "lockbench: failed\n");
+    exit();
+  }
+  printf(1, "acquire/release: %d cycles\n", c);
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    getpid_syscall();
+  t1 = rdtsc();
+  printf(1, "getpid syscall:  %d cycles\n", (uint)(t1 - t0) / n);
+
+  exit();
+}
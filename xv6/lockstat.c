@@ -0,0 +1,36 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+
+// usage: lockstat [-r]
+// print the kernel's spinlock counters, one line per lock
+// name; -r also resets them
+int
+main(int argc, char *argv[])
+{
+  static struct lockstat st[NLOCKSTAT];  // too big for the stack
+  int i, n, reset;
+
+  reset = argc > 1 && strcmp(argv[1], "-r") == 0;
+  if(argc > 2 || (argc == 2 && !reset)){
+    printf(2, "usage: lockstat [-r]\n");
+    exit();
+  }
+  n = lockstat(st, NLOCKSTAT, reset);
+  if(n < 0){
+    printf(2, "lockstat: failed\n");
+    exit();
+  }
+
+  printf(1, "name            acquires    contended   spin_cycles         max_hold\n");
+  for(i = 0; i < n; i++){
+    if(st[i].nacquire == 0)
+      continue;
+    printf(1, "%s        %d        %d        %l        %l\n", st[i].name,
+           st[i].nacquire, st[i].ncontended, st[i].spin_cycles,
+           st[i].max_hold_cycles);
+  }
+  exit();
+}
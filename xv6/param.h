@@ -1,4 +1,4 @@
-#define NPROC        64  // maximum number of processes
+#define NPROC       256  // maximum number of processes
 #define KSTACKSIZE 4096  // size of per-process kernel stack
 #define NCPU          8  // maximum number of CPUs
 #define NOFILE       16  // open files per process
@@ -11,4 +11,10 @@
 #define LOGSIZE      (MAXOPBLOCKS*3)  // max data blocks in on-disk log
 #define NBUF         (MAXOPBLOCKS*3)  // size of disk block cache
 #define FSSIZE       1000  // size of file system in blocks
+#define NLATBUCKET   32  // log2 buckets of wakeup-to-run latency
+#define NSEM       1024  // maximum number of semaphores
+#define SEMNAME      16  // longest semaphore name, with its nul
+#define NLOCKSTAT    64  // lock names with their own lockstat counters
+#define NSYSCALL     64  // syscall numbers are below this
+#define NPIBOOST      8  // held semaphores a process inherits levels through
 
@@ -3,8 +3,13 @@
 #include "user.h"
 #include "fcntl.h"
 #define SEMCOUNT 5
+#define MAXSEM 250
 #define EATROUND 5
 
+// usage: phillsofs [philosophers]
+// Each fork is a semaphore; philosophers are processes.
+int semcount;
+
 void philosopher(int id, int l, int r) {
     for(int i = 0; i < EATROUND; i++) {
         if(id % 2 == 0) {
@@ -15,36 +20,48 @@ void philosopher(int id, int l, int r) {
             sem_acquire(r);
             sem_acquire(l);
         }
-        sleep(30 * id);
+        sleep(id % 10);
         printf(1, "philosopher %d begins eating with forks %d , %d\n", id, l + 1, r + 1);
-        sleep(300);
+        sleep(30);
         sem_release(l);
         sem_release(r);
         printf(1, "philosopher %d done\n", id);
     }
 }
 
-void init_game() {
-    for(int i = 0; i < SEMCOUNT; i++)
-        sem_init(i, 1);
+int init_game() {
+    for(int i = 0; i < semcount; i++)
+        if(sem_init(i, 1) < 0)
+            return -1;
+    return 0;
 }
 
 void start_game() {
-    for(int i = 0; i < SEMCOUNT; i++) {
+    for(int i = 0; i < semcount; i++) {
         int pid = fork();
         
         if(pid == 0) {
-            philosopher(i + 1, i, (i + 1) % SEMCOUNT);
+            philosopher(i + 1, i, (i + 1) % semcount);
             exit();
         }
+        if(pid < 0)
+            printf(2, "phillsofs: fork failed for philosopher %d\n", i + 1);
     }
     
-    while (wait());
+    while (wait() >= 0);
     exit();
 }
 
 int main(int argc, char *argv[])
 {
-    init_game();
+    semcount = argc > 1 ? atoi(argv[1]) : SEMCOUNT;
+    if(semcount < 2 || semcount > MAXSEM) {
+        printf(2, "usage: phillsofs [philosophers], 2 to %d\n", MAXSEM);
+        exit();
+    }
+    if(init_game() < 0) {
+        printf(2, "phillsofs: cannot set up %d forks\n", semcount);
+        exit();
+    }
     start_game();
 }
@@ -2,9 +2,9 @@
 #include "defs.h"
 #include "param.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "fs.h"
-#include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
 
@@ -84,6 +84,7 @@ pipewrite(struct pipe *p, char *addr, int n)
   for(i = 0; i < n; i++){
     while(p->nwrite == p->nread + PIPESIZE){  //DOC: pipewrite-full
       if(p->readopen == 0 || myproc()->killed){
+        wakeup_one(&p->nwrite);  // pass on a wakeup we may have taken
         release(&p->lock);
         return -1;
       }
@@ -92,6 +93,10 @@ pipewrite(struct pipe *p, char *addr, int n)
     }
     p->data[p->nwrite++ % PIPESIZE] = addr[i];
   }
+  // Readers wake one writer at a time; if room is left,
+  // hand the wakeup on to the next waiting writer.
+  if(p->nwrite != p->nread + PIPESIZE)
+    wakeup_one(&p->nwrite);
   wakeup(&p->nread);  //DOC: pipewrite-wakeup1
   release(&p->lock);
   return n;
@@ -115,7 +120,7 @@ piperead(struct pipe *p, char *addr, int n)
       break;
     addr[i] = p->data[p->nread++ % PIPESIZE];
   }
-  wakeup(&p->nwrite);  //DOC: piperead-wakeup
+  wakeup_one(&p->nwrite);  //DOC: piperead-wakeup
   release(&p->lock);
   return i;
 }
@@ -2,11 +2,122 @@
 #include "stat.h"
 #include "user.h"
 #include "fcntl.h"
+#include "param.h"
+#include "sched.h"
 
+// Output is built up here and written in large pieces.
+static char out[1024];
+static int outlen;
+
+static void
+flush(void)
+{
+  write(1, out, outlen);
+  outlen = 0;
+}
+
+static void
+putc(char c)
+{
+  if(outlen == sizeof(out))
+    flush();
+  out[outlen++] = c;
+}
+
+static void
+puts(char *s)
+{
+  while(*s)
+    putc(*s++);
+}
+
+// Print n, then pad with spaces to width columns.
+// Returns the number of characters n took.
+static int
+putint(int n, int width)
+{
+  char buf[12];
+  int i, len;
+
+  i = len = 0;
+  if(n < 0){
+    putc('-');
+    n = -n;
+    len++;
+  }
+  do{
+    buf[i++] = '0' + n % 10;
+    n /= 10;
+  }while(n);
+  len += i;
+  while(i > 0)
+    putc(buf[--i]);
+  for(width -= len; width > 0; width--)
+    putc(' ');
+  return len;
+}
+
+// Print a rank kept in tenths with two decimals, padded.
+static void
+putrank(int rank, int width)
+{
+  int len;
+
+  len = putint(rank / 10, 0);
+  putc('.');
+  putc('0' + rank % 10);
+  putc('0');
+  for(width -= len + 3; width > 0; width--)
+    putc(' ');
+}
+
+static void
+putstr(char *s, int width)
+{
+  puts(s);
+  for(width -= strlen(s); width > 0; width--)
+    putc(' ');
+}
+
+static char *states[] = { "UNUSED", "EMBRYO", "SLEEPING", "RUNNABLE", "RUNNING", "ZOMBIE" };
+static char *queues[] = { "EDF", "RoundRobin", "Lottery", "BJF" };
 
 int
 main(int argc, char *argv[])
 {
-  print_all_procs();
+  struct procinfo *procs, *p;
+  int n;
+
+  if((procs = malloc(NPROC * sizeof(*procs))) == 0){
+    printf(2, "print_procs: out of memory\n");
+    exit();
+  }
+  if((n = getprocs(procs, NPROC)) < 0){
+    printf(2, "print_procs: getprocs failed\n");
+    exit();
+  }
+
+  puts("name       pid       state       queue       arrival_time        tickets     p_ratio      e_ratio       a_ratio       rank       exec_cycle    cpu\n");
+  puts("........................................................................................................................................................\n");
+  for(p = procs; p < &procs[n]; p++){
+    putstr(p->name, 11);
+    putint(p->pid, 10);
+    putstr(p->state >= 0 && p->state <= 5 ? states[p->state] : "???", 12);
+    putstr(p->queue >= 0 && p->queue <= 3 ? queues[p->queue] : "???", 12);
+    putint(p->entered_queue, 20);
+    putint(p->tickets, 11);
+    putint(p->priority_ratio, 13);
+    putint(p->executed_cycle_ratio, 14);
+    putint(p->arrival_time_ratio, 14);
+    putrank(p->rank, 12);
+    putint(p->executed_cycle, 14);
+    if(p->last_cpu >= 0)
+      putint(p->last_cpu, 0);
+    else
+      putc('-');
+    putc('\n');
+  }
+  flush();
+  free(procs);
   exit();
-}
\ No newline at end of file
+}
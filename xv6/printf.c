@@ -35,7 +35,37 @@ printint(int fd, int xx, int base, int sgn)
     putc(fd, buf[i]);
 }
 
-// Print to the given fd. Only understands %d, %x, %p, %s.
+// Print an unsigned 64-bit number in decimal. Divides in
+// 16-bit steps so that no 64-bit division helper is needed.
+static void
+printlong(int fd, uint64 x)
+{
+  static char digits[] = "0123456789";
+  char buf[24];
+  uint hi, mid, lo, r;
+  int i;
+
+  i = 0;
+  do{
+    hi = x >> 32;
+    r = hi % 10;
+    hi /= 10;
+    mid = (r << 16) | ((uint)x >> 16);
+    r = mid % 10;
+    mid /= 10;
+    lo = (r << 16) | ((uint)x & 0xFFFF);
+    r = lo % 10;
+    lo /= 10;
+    x = ((uint64)hi << 32) | (mid << 16) | lo;
+    buf[i++] = digits[r];
+  }while(x != 0);
+
+  while(--i >= 0)
+    putc(fd, buf[i]);
+}
+
+// Print to the given fd. Only understands %d, %x, %p, %s,
+// %c and %l (unsigned 64-bit decimal).
 void
 printf(int fd, const char *fmt, ...)
 {
@@ -60,6 +90,9 @@ printf(int fd, const char *fmt, ...)
       } else if(c == 'x' || c == 'p'){
         printint(fd, *ap, 16, 0);
         ap++;
+      } else if(c == 'l'){
+        printlong(fd, *(uint64*)ap);
+        ap += 2;
       } else if(c == 's'){
         s = (char*)*ap;
         ap++;
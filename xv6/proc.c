@@ -4,93 +4,161 @@
 #include "memlayout.h"
 #include "mmu.h"
 #include "x86.h"
-#include "proc.h"
 #include "spinlock.h"
-
-#define STARVING_THRESHOLD 8000
-#define MIN_BJF_RANK 1000000
+#include "proc.h"
+#include "traps.h"
+#include "sched.h"
+#include "kinfo.h"
+
+#define STARVING_THRESHOLD 8000  // default for starving_threshold
+#define AGING_WHEEL_SIZE 256
+#define RR_QUANTUM 2       // default time slices, in timer ticks
+#define LOTTERY_QUANTUM 4
+#define BJF_QUANTUM 8
+#define EDF_UTIL_SCALE 1000  // EDF utilization is kept in thousandths
 #define DEFAULT_MAX_TICKETS 30
-#define MAX_SEMAPHORE_PROC NPROC
-#define MAX_SEMAPHORE 5
-
+#define RANK_SCALE 10  // ranks and executed cycles are kept in tenths
+
+// Locking. There is no lock over the whole process table;
+// each process has its own p->lock, and the structures that
+// link processes together have their own locks. Where more
+// than one is needed they are taken in this order:
+//
+//   wait_lock, futex bucket, sleep queue bucket, p->lock, edf_lock,
+//   run queue, pid_lock
+//
+// A process holds its own p->lock across the swtch() in and
+// out of the scheduler, as in sched() and scheduler().
 struct {
-  struct spinlock lock;
   struct proc proc[NPROC];
 } ptable;
 
 static struct proc *initproc;
 
-struct semaphore {
-  int value, front_proc_index, procs_queue_size;
-  struct proc *queue[MAX_SEMAPHORE_PROC];
+// Protects nextpid and the pid hash.
+struct spinlock pid_lock;
+
+// Protects every process's parent, children and zombies, so
+// that wakeups of a parent in wait() are not lost. Taken
+// before any p->lock.
+struct spinlock wait_lock;
+
+// Protects every run queue's edf_util, for EDF admission.
+struct spinlock edf_lock;
+
+// Per-CPU run queue. A RUNNABLE process sits on at most one
+// level list of one run queue (p->cpu names which, p->onrq
+// says whether it is there yet: the scheduler dequeues a
+// process before it locks and runs it). Bit q of levels is
+// set iff level list q is non-empty.
+// Protected by lock, except that nrunnable may be peeked
+// without it.
+struct runqueue {
   struct spinlock lock;
-} semtable[MAX_SEMAPHORE];
-
-void
-sem_init(int i, int value)
-{
-  semtable[i].value = value;
-  semtable[i].front_proc_index = 0;
-  semtable[i].procs_queue_size = 0;
-}
-
-void
-sem_acquire(int i)
-{
-  acquire(&semtable[i].lock);
+  struct proc *head[NQUEUE];
+  struct proc *tail[NQUEUE];
+  int count[NQUEUE];          // processes on each level list
+  uint levels;                // bitmap of non-empty levels
+  int tickets;                // sum of tickets on the lottery level
+  int ticket_tree[NPROC+1];   // Fenwick tree of lottery tickets by ptable slot
+  struct proc *bjf_heap[NPROC]; // BJF level as a min-heap on p->rank
+  struct proc *wheel[AGING_WHEEL_SIZE]; // lower-level processes by age_deadline
+  volatile int naging;        // processes on the wheel
+  uint wheel_tick;            // last tick the wheel was advanced to
+  uint promotions;            // starving processes promoted to round robin
+  uint boosts;                // holders of a wanted semaphore boosted
+  volatile int nrunnable;
+  volatile int nallowed[NCPU]; // queued processes allowed to run on each CPU
+  struct proc *edf;           // EDF jobs with budget left, earliest deadline first
+  struct proc *throttled;     // EDF jobs out of budget until their next period
+  int edf_util;               // EDF utilization admitted here (edf_lock)
+} runqueues[NCPU];
+
+// Sleeping processes hashed by wait channel, each bucket in
+// the order its processes went to sleep.
+#define NSLEEPQ 64
+struct sleepq {
+  struct spinlock lock;
+  struct proc *head;
+  struct proc *tail;
+} sleepq[NSLEEPQ];
+
+// Futex waiters sleep on the futex's key in the sleep queue
+// bucket it hashes to. The matching futex bucket lock makes
+// futex_wait's check of the word and its sleep one step for
+// futex_wake.
+struct spinlock futexq[NSLEEPQ];
+
+// Allocated processes hashed by pid.
+// Protected by pid_lock.
+#define NPIDHASH 64
+struct proc *pidhash[NPIDHASH];
+
+// Ticks a process may wait on the lottery or BJF level
+// before it is promoted to round robin.
+static uint starving_threshold = STARVING_THRESHOLD;
+
+// Time slice of each level, and whether a process that uses
+// up a whole slice there moves one level down. Indexed by
+// queue-1 and read without a lock.
+static int quantum[NQUEUE] = { RR_QUANTUM, LOTTERY_QUANTUM, BJF_QUANTUM };
+static int demote[NQUEUE] = { 1, 1, 0 };
 
-  if(semtable[i].value <= 0) {
-    struct proc *p = myproc();
-    int index = (semtable[i].front_proc_index + semtable[i].procs_queue_size) % MAX_SEMAPHORE_PROC;
-    semtable[i].procs_queue_size++;
-    semtable[i].queue[index] = p;
-    sleep(&p->pid, &semtable[i].lock);
-  }
-  semtable[i].value--;
+int nextpid = 1;
+extern void forkret(void);
+extern void trapret(void);
 
-  release(&semtable[i].lock);
-}
+static int least_loaded_cpu(uint mask);
 
-void 
-sem_release(int i)
+// Next value of this CPU's xorshift generator. Needs no
+// lock: each CPU only touches its own state.
+static uint
+rand_next(void)
 {
-  acquire(&semtable[i].lock);
-  semtable[i].value++;
-
-  if(semtable[i].value > 0 && semtable[i].procs_queue_size > 0) {
-      int index = semtable[i].front_proc_index;
-      semtable[i].front_proc_index = (semtable[i].front_proc_index + 1) % MAX_SEMAPHORE_PROC;
-      semtable[i].procs_queue_size--;
-      wakeup(&semtable[i].queue[index]->pid);
-  }
-
+  struct cpu *c;
+  uint x;
 
-  release(&semtable[i].lock);
+  pushcli();
+  c = mycpu();
+  x = c->rand;
+  if(x == 0)
+    x = (uint)rdtsc() ^ ((c - cpus + 1) * 0x9E3779B9) ^ 1;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  c->rand = x;
+  popcli();
+  return x;
 }
 
-int nextpid = 1;
-extern void forkret(void);
-extern void trapret(void);
-
-static void wakeup1(void *chan);
-
+// Uniformly distributed random number in [min, max].
 int
 generate_random_number(int min, int max)
 {
     if (min >= max)
         return max > 0 ? max : -1 * max;
-    acquire(&tickslock);
-    int rand_num, diff = max - min + 1, time = ticks;
-    release(&tickslock);
-    rand_num = (1 + (1 + ((time + 2) % diff ) * (time + 1) * 132) % diff) * (1 + time % max) * (1 + 2 * max % diff);
-    rand_num = rand_num % (max - min + 1) + min;
-    return rand_num;
+    return min + rand_next() % (uint)(max - min + 1);
 }
 
 void
 pinit(void)
 {
-  initlock(&ptable.lock, "ptable");
+  struct proc *p;
+  int i;
+
+  initlock(&pid_lock, "nextpid");
+  initlock(&wait_lock, "wait");
+  initlock(&edf_lock, "edf");
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    initlock(&p->lock, "proc");
+    initlock(&p->tlock, "thread");
+  }
+  for(i = 0; i < NCPU; i++)
+    initlock(&runqueues[i].lock, "runqueue");
+  for(i = 0; i < NSLEEPQ; i++){
+    initlock(&sleepq[i].lock, "sleepq");
+    initlock(&futexq[i], "futex");
+  }
 }
 
 // Must be called with interrupts disabled
@@ -100,18 +168,30 @@ cpuid() {
 }
 
 // Must be called with interrupts disabled to avoid the caller being
-// rescheduled between reading lapicid and running through the loop.
+// rescheduled between reading %gs and using the result.
+// seginit() points %gs at this CPU's struct cpu.
 struct cpu*
 mycpu(void)
 {
-  int apicid, i;
-  
+  struct cpu *c;
+
   if(readeflags()&FL_IF)
     panic("mycpu called with interrupts enabled\n");
-  
+
+  asm volatile("movl %%gs:0, %0" : "=r" (c));
+  return c;
+}
+
+// Search cpus[] for the entry of the CPU we are on. Only
+// seginit() needs this, before %gs is set up; after that
+// use mycpu().
+struct cpu*
+lapiccpu(void)
+{
+  int apicid, i;
+
   apicid = lapicid();
-  // APIC IDs are not guaranteed to be contiguous. Maybe we should have
-  // a reverse map, or reserve a register to store &cpus[i].
+  // APIC IDs are not guaranteed to be contiguous.
   for (i = 0; i < ncpu; ++i) {
     if (cpus[i].apicid == apicid)
       return &cpus[i];
@@ -119,23 +199,618 @@ mycpu(void)
   panic("unknown apicid\n");
 }
 
-// Disable interrupts so that we are not rescheduled
-// while reading proc from the cpu structure
+// The process running on this CPU. This is a single load,
+// so it needs no pushcli: whatever CPU it runs on, that
+// CPU's %gs:4 is the process doing the load.
 struct proc*
 myproc(void) {
+  struct proc *p;
+
+  asm volatile("movl %%gs:4, %0" : "=r" (p));
+  return p;
+}
+
+//PAGEBREAK: 36
+// Run queues.
+
+// Weight of p in its run queue's lottery.
+static int
+ticket_weight(struct proc *p)
+{
+  return p->tickets > 0 ? p->tickets : 0;
+}
+
+// Add delta tickets to ptable slot i in rq's lottery tree.
+static void
+ticket_update(struct runqueue *rq, int i, int delta)
+{
+  rq->tickets += delta;
+  for(i++; i <= NPROC; i += i & -i)
+    rq->ticket_tree[i] += delta;
+}
+
+// Ptable slot holding ticket number k, 1 <= k <= rq->tickets.
+// Descends the Fenwick tree, so O(log NPROC).
+static int
+ticket_find(struct runqueue *rq, int k)
+{
+  int pos, step;
+
+  for(step = 1; step << 1 <= NPROC; step <<= 1)
+    ;
+  for(pos = 0; step > 0; step >>= 1){
+    if(pos + step <= NPROC && rq->ticket_tree[pos + step] < k){
+      pos += step;
+      k -= rq->ticket_tree[pos];
+    }
+  }
+  return pos;
+}
+
+static void
+heap_swap(struct runqueue *rq, int i, int j)
+{
+  struct proc *t;
+
+  t = rq->bjf_heap[i];
+  rq->bjf_heap[i] = rq->bjf_heap[j];
+  rq->bjf_heap[j] = t;
+  rq->bjf_heap[i]->heap_index = i;
+  rq->bjf_heap[j]->heap_index = j;
+}
+
+// Restore heap order around slot i after its rank changed.
+static void
+heap_fix(struct runqueue *rq, int i)
+{
+  int n, child;
+
+  while(i > 0 && rq->bjf_heap[i]->rank < rq->bjf_heap[(i-1)/2]->rank){
+    heap_swap(rq, i, (i-1)/2);
+    i = (i-1)/2;
+  }
+  n = rq->count[BJF_QUEUE-1];
+  for(;;){
+    child = 2*i + 1;
+    if(child >= n)
+      break;
+    if(child+1 < n && rq->bjf_heap[child+1]->rank < rq->bjf_heap[child]->rank)
+      child++;
+    if(rq->bjf_heap[i]->rank <= rq->bjf_heap[child]->rank)
+      break;
+    heap_swap(rq, i, child);
+    i = child;
+  }
+}
+
+// Heap operations run before enqueue_proc/dequeue_proc
+// adjust count[], which is the heap's size.
+static void
+heap_push(struct runqueue *rq, struct proc *p)
+{
+  int n = rq->count[BJF_QUEUE-1];
+
+  rq->bjf_heap[n] = p;
+  p->heap_index = n;
+  heap_fix(rq, n);
+}
+
+static void
+heap_remove(struct runqueue *rq, struct proc *p)
+{
+  int i = p->heap_index;
+  int last = rq->count[BJF_QUEUE-1] - 1;
+
+  if(i != last){
+    heap_swap(rq, i, last);
+    rq->count[BJF_QUEUE-1]--;
+    heap_fix(rq, i);
+    rq->count[BJF_QUEUE-1]++;
+  }
+  rq->bjf_heap[last] = 0;
+  p->heap_index = -1;
+}
+
+// Recompute p's BJF rank in fixed point. Called whenever
+// one of its inputs changes; if p is waiting in a BJF
+// heap, its position there is repaired.
+// Caller must hold p->lock, or p's run queue lock if p is
+// queued there.
+static void
+update_rank(struct proc *p)
+{
+  p->rank =
+    (p->priority * p->priority_ratio
+     + p->entered_queue * p->arrival_time_ratio) * RANK_SCALE
+    + p->executed_cycle * p->executed_cycle_ratio;
+  if(p->heap_index >= 0)
+    heap_fix(&runqueues[p->cpu], p->heap_index);
+}
+
+// Aging. Processes waiting on the lottery or BJF level sit
+// on their run queue's timing wheel in the slot for their
+// promotion deadline; each slot is kept sorted by deadline
+// so that advancing the wheel touches only the processes
+// that are actually due.
+
+static void
+age_insert(struct runqueue *rq, struct proc *p)
+{
+  struct proc **pp, *prev;
+
+  p->age_deadline = p->entered_queue + starving_threshold;
+  prev = 0;
+  for(pp = &rq->wheel[p->age_deadline % AGING_WHEEL_SIZE]; *pp; pp = &(*pp)->age_next){
+    if((*pp)->age_deadline > p->age_deadline)
+      break;
+    prev = *pp;
+  }
+  p->age_next = *pp;
+  p->age_prev = prev;
+  if(*pp)
+    (*pp)->age_prev = p;
+  *pp = p;
+  rq->naging++;
+}
+
+static void
+age_remove(struct runqueue *rq, struct proc *p)
+{
+  if(p->age_prev)
+    p->age_prev->age_next = p->age_next;
+  else
+    rq->wheel[p->age_deadline % AGING_WHEEL_SIZE] = p->age_next;
+  if(p->age_next)
+    p->age_next->age_prev = p->age_prev;
+  p->age_next = p->age_prev = 0;
+  rq->naging--;
+}
+
+// Move a starving process (not on any list) to round robin.
+static void
+promote(struct runqueue *rq, struct proc *p)
+{
+  p->queue = RR_QUEUE;
+  if(p->pi_queue)  // keep the promotion once the boost ends
+    p->pi_queue = RR_QUEUE;
+  p->entered_queue = ticks;
+  update_rank(p);
+  rq->promotions++;
+}
+
+// Count p in or out of rq's runnable totals.
+static void
+count_runnable(struct runqueue *rq, struct proc *p, int delta)
+{
+  uint mask;
+
+  rq->nrunnable += delta;
+  for(mask = p->affinity; mask; mask &= mask - 1)
+    rq->nallowed[bsf(mask)] += delta;
+}
+
+// EDF. Jobs with budget left wait on their run queue's edf
+// list, earliest deadline first; a job that has used up its
+// budget waits on the throttled list, not counted as
+// runnable, until its next period starts (see aging_tick).
+
+static void
+edf_insert(struct runqueue *rq, struct proc *p)
+{
+  struct proc **pp, *prev;
+
+  prev = 0;
+  pp = &rq->throttled;
+  if(p->edf_budget > 0){
+    for(pp = &rq->edf; *pp && (*pp)->edf_deadline <= p->edf_deadline; pp = &(*pp)->rq_next)
+      prev = *pp;
+    count_runnable(rq, p, 1);
+  }
+  p->rq_next = *pp;
+  p->rq_prev = prev;
+  if(*pp)
+    (*pp)->rq_prev = p;
+  *pp = p;
+}
+
+static void
+edf_remove(struct runqueue *rq, struct proc *p)
+{
+  struct proc **head;
+
+  head = &rq->throttled;
+  if(p->edf_budget > 0){
+    head = &rq->edf;
+    count_runnable(rq, p, -1);
+  }
+  if(p->rq_prev)
+    p->rq_prev->rq_next = p->rq_next;
+  else
+    *head = p->rq_next;
+  if(p->rq_next)
+    p->rq_next->rq_prev = p->rq_prev;
+  p->rq_next = p->rq_prev = 0;
+}
+
+// p woke up. It keeps its current deadline and budget only
+// if using the rest of the budget before that deadline
+// stays within its reserved share; otherwise its next job
+// starts now.
+static void
+edf_wakeup(struct proc *p)
+{
+  uint now = ticks;
+
+  if(p->edf_deadline <= now ||
+     p->edf_budget * p->edf_period > (p->edf_deadline - now) * p->edf_runtime){
+    p->edf_deadline = now + p->edf_period;
+    p->edf_budget = p->edf_runtime;
+  }
+}
+
+// p's job reached its deadline with budget left. Count the
+// miss and start the next job.
+static void
+edf_miss(struct proc *p)
+{
+  p->edf_misses++;
+  while(p->edf_deadline <= ticks)
+    p->edf_deadline += p->edf_period;
+  p->edf_budget = p->edf_runtime;
+}
+
+static void
+edf_report(int pid, uint deadline)
+{
+  cprintf("pid %d missed its deadline at tick %d\n", pid, deadline);
+}
+
+// Give back the CPU share reserved for p.
+// Caller must hold p->lock.
+static void
+edf_unreserve(struct proc *p)
+{
+  acquire(&edf_lock);
+  runqueues[p->edf_cpu].edf_util -= p->edf_util;
+  release(&edf_lock);
+  p->edf_util = 0;
+}
+
+// Append p to the tail of its level list on run queue cpu.
+// Caller must hold that run queue's lock, and p->lock if p
+// is moving between run queues.
+static void
+enqueue_proc(struct proc *p, int cpu)
+{
+  struct runqueue *rq = &runqueues[cpu];
+  int q;
+
+  p->cpu = cpu;
+  if(p->queue == EDF_QUEUE){
+    edf_insert(rq, p);
+    p->onrq = 1;
+    return;
+  }
+  if(p->queue != RR_QUEUE){
+    if(ticks - p->entered_queue >= starving_threshold)
+      promote(rq, p);
+    else
+      age_insert(rq, p);
+  }
+  q = p->queue - 1;
+  if(p->queue == BJF_QUEUE)
+    heap_push(rq, p);
+  p->rq_next = 0;
+  p->rq_prev = rq->tail[q];
+  if(rq->tail[q])
+    rq->tail[q]->rq_next = p;
+  else
+    rq->head[q] = p;
+  rq->tail[q] = p;
+  rq->count[q]++;
+  rq->levels |= 1 << q;
+  if(p->queue == LOTTERY_QUEUE)
+    ticket_update(rq, p - ptable.proc, ticket_weight(p));
+  p->onrq = 1;
+  count_runnable(rq, p, 1);
+}
+
+// Unlink p from the run queue it is on.
+// Caller must hold that run queue's lock.
+static void
+dequeue_proc(struct proc *p)
+{
+  struct runqueue *rq = &runqueues[p->cpu];
+  int q = p->queue - 1;
+
+  if(p->queue == EDF_QUEUE){
+    edf_remove(rq, p);
+    p->onrq = 0;
+    return;
+  }
+  if(p->queue == BJF_QUEUE)
+    heap_remove(rq, p);
+  if(p->queue != RR_QUEUE)
+    age_remove(rq, p);
+  if(p->rq_prev)
+    p->rq_prev->rq_next = p->rq_next;
+  else
+    rq->head[q] = p->rq_next;
+  if(p->rq_next)
+    p->rq_next->rq_prev = p->rq_prev;
+  else
+    rq->tail[q] = p->rq_prev;
+  p->rq_next = p->rq_prev = 0;
+  if(--rq->count[q] == 0)
+    rq->levels &= ~(1 << q);
+  if(p->queue == LOTTERY_QUEUE)
+    ticket_update(rq, p - ptable.proc, -ticket_weight(p));
+  p->onrq = 0;
+  count_runnable(rq, p, -1);
+}
+
+// Mark p RUNNABLE and queue it on cpu's run queue, or on
+// the least loaded CPU it may use if cpu is not one.
+// Callers pass the CPU p last ran on, so by default a
+// process stays where its cache is warm.
+// Caller must hold p->lock.
+static void
+make_runnable(struct proc *p, int cpu)
+{
+  struct runqueue *rq;
+
+  if(!(p->affinity & (1 << cpu)))
+    cpu = least_loaded_cpu(p->affinity);
+  rq = &runqueues[cpu];
+  // A process coming off a CPU is timed by sched().
+  if(p->state == SLEEPING || p->state == EMBRYO){
+    p->stat_tsc = rdtsc();
+    if(p->queue == EDF_QUEUE)
+      edf_wakeup(p);
+  }
+  acquire(&rq->lock);
+  p->state = RUNNABLE;
+  enqueue_proc(p, cpu);
+  release(&rq->lock);
+}
+
+// Lock the run queue p belongs to and return it. Caller
+// must hold p->lock, which keeps p->cpu from changing.
+static struct runqueue*
+lock_runqueue(struct proc *p)
+{
+  struct runqueue *rq = &runqueues[p->cpu];
+
+  acquire(&rq->lock);
+  return rq;
+}
+
+// CPU in mask with the fewest runnable processes, counting
+// the one it is running. Used to place new processes.
+static int
+least_loaded_cpu(uint mask)
+{
+  int i, load, best, best_load;
+
+  best = 0;
+  best_load = -1;
+  for(i = 0; i < ncpu; i++){
+    if(!(mask & (1 << i)))
+      continue;
+    load = runqueues[i].nrunnable + (cpus[i].proc != 0);
+    if(best_load < 0 || load < best_load){
+      best = i;
+      best_load = load;
+    }
+  }
+  return best;
+}
+
+// Run queue other than rq with the most processes that
+// rq's CPU is allowed to run, or 0 if there are none.
+// Reads the counts without any lock, so the answer is
+// only a hint.
+static struct runqueue*
+busiest_runqueue(struct runqueue *rq)
+{
+  struct runqueue *r, *busiest;
+  int cpu = rq - runqueues;
+
+  busiest = 0;
+  for(r = runqueues; r < &runqueues[ncpu]; r++){
+    if(r == rq || r->nallowed[cpu] == 0)
+      continue;
+    if(busiest == 0 || r->nallowed[cpu] > busiest->nallowed[cpu])
+      busiest = r;
+  }
+  return busiest;
+}
+
+// p was just queued on p->cpu. If that CPU is halted in
+// scheduler(), send it a reschedule IPI; if it is busy,
+// wake some idle CPU p may run on instead so it can steal
+// the work.
+// Caller must hold p->lock.
+static void
+kick_cpu(struct proc *p)
+{
+  struct cpu *c, *me;
+
+  me = mycpu();
+  c = &cpus[p->cpu];
+  if(!c->idle){
+    for(c = cpus; c < &cpus[ncpu]; c++)
+      if(c->idle && c != me && (p->affinity & (1 << (c - cpus))))
+        break;
+    if(c == &cpus[ncpu])
+      return;
+  }
+  if(c == me || cmpxchg(&c->ipi_pending, 0, 1) != 0)
+    return;  // an IPI is already on its way
+  c->ipi_tsc = rdtsc();
+  me->ipis_sent++;
+  lapicipi(c->apicid, T_IRQ0 + IRQ_RESCHED);
+}
+
+// Halt this CPU until an interrupt arrives, unless work
+// showed up since the caller last looked. c->idle is
+// published before the final check, so a concurrent
+// kick_cpu() either sees it and sends an IPI or queued
+// its work early enough for the check to see it.
+// ipi_pending is cleared before that, so a kicker that
+// claimed it after reading a stale c->idle cannot keep
+// later kickers from sending.
+static void
+idle(struct cpu *c, struct runqueue *rq)
+{
+  uint64 t0, t1, sent;
+
+  cli();
+  c->ipi_tsc = 0;
+  c->ipi_pending = 0;
+  c->idle = 1;
+  __sync_synchronize();
+  if(rq->nrunnable == 0 && busiest_runqueue(rq) == 0){
+    c->halts++;
+    t0 = rdtsc();
+    sti_hlt();
+    cli();
+    t1 = rdtsc();
+    c->idle_cycles += t1 - t0;
+    sent = c->ipi_tsc;
+    if(sent != 0 && sent >= t0 && sent <= t1){
+      c->ipis_received++;
+      c->wake_cycles += t1 - sent;
+      if(t1 - sent > c->max_wake_cycles)
+        c->max_wake_cycles = t1 - sent;
+    }
+  }
+  c->idle = 0;
+}
+
+// Copy the scheduler counters of up to n CPUs to st.
+// Returns the number of CPUs copied.
+int
+cpustat(struct cpustat *st, int n)
+{
   struct cpu *c;
+  int i;
+
+  for(i = 0; i < n && i < ncpu; i++){
+    c = &cpus[i];
+    st[i].halts = c->halts;
+    st[i].ipis_sent = c->ipis_sent;
+    st[i].ipis_received = c->ipis_received;
+    st[i].idle_cycles = c->idle_cycles;
+    st[i].wake_cycles = c->wake_cycles;
+    st[i].max_wake_cycles = c->max_wake_cycles;
+    st[i].promotions = runqueues[i].promotions;
+    st[i].boosts = runqueues[i].boosts;
+  }
+  return i;
+}
+
+// Push p onto a parent's children or zombies list.
+// Caller must hold wait_lock.
+static void
+sibling_insert(struct proc **head, struct proc *p)
+{
+  p->sibling_prev = 0;
+  p->sibling_next = *head;
+  if(*head)
+    (*head)->sibling_prev = p;
+  *head = p;
+}
+
+static void
+sibling_remove(struct proc **head, struct proc *p)
+{
+  if(p->sibling_prev)
+    p->sibling_prev->sibling_next = p->sibling_next;
+  else
+    *head = p->sibling_next;
+  if(p->sibling_next)
+    p->sibling_next->sibling_prev = p->sibling_prev;
+  p->sibling_next = p->sibling_prev = 0;
+}
+
+// Pid index. Every process from allocproc() until it is
+// freed is on the chain for its pid.
+
+// Give p the next pid and index it. Caller must hold p->lock.
+static void
+allocpid(struct proc *p)
+{
+  struct proc **head;
+
+  acquire(&pid_lock);
+  p->pid = nextpid++;
+  head = &pidhash[p->pid % NPIDHASH];
+  p->pid_next = *head;
+  *head = p;
+  release(&pid_lock);
+}
+
+// Caller must hold p->lock.
+static void
+pid_remove(struct proc *p)
+{
+  struct proc **pp;
+
+  acquire(&pid_lock);
+  for(pp = &pidhash[p->pid % NPIDHASH]; *pp; pp = &(*pp)->pid_next){
+    if(*pp == p){
+      *pp = p->pid_next;
+      break;
+    }
+  }
+  p->pid_next = 0;
+  release(&pid_lock);
+}
+
+// The process with the given pid, returned with its lock
+// held, or 0. pid_lock comes after p->lock in the lock
+// order, so the slot is locked only after the hash chain
+// is let go, and then checked again.
+static struct proc*
+findproc(int pid)
+{
   struct proc *p;
-  pushcli();
-  c = mycpu();
-  p = c->proc;
-  popcli();
+
+  if(pid <= 0)
+    return 0;
+  acquire(&pid_lock);
+  for(p = pidhash[pid % NPIDHASH]; p; p = p->pid_next)
+    if(p->pid == pid)
+      break;
+  release(&pid_lock);
+  if(p == 0)
+    return 0;
+
+  acquire(&p->lock);
+  if(p->pid != pid || p->state == UNUSED){
+    release(&p->lock);
+    return 0;
+  }
   return p;
 }
 
+// Give back a slot that allocproc() handed out but that
+// never became a running process. Releases p->lock.
+static void
+unallocproc(struct proc *p)
+{
+  pid_remove(p);
+  p->pid = 0;
+  p->state = UNUSED;
+  release(&p->lock);
+}
+
 //PAGEBREAK: 32
 // Look in the process table for an UNUSED proc.
 // If found, change state to EMBRYO and initialize
-// state required to run in the kernel.
+// state required to run in the kernel, and return
+// with p->lock held.
 // Otherwise return 0.
 static struct proc*
 allocproc(void)
@@ -143,24 +818,21 @@ allocproc(void)
   struct proc *p;
   char *sp;
 
-  acquire(&ptable.lock);
-
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++)
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    acquire(&p->lock);
     if(p->state == UNUSED)
       goto found;
-
-  release(&ptable.lock);
+    release(&p->lock);
+  }
   return 0;
 
 found:
   p->state = EMBRYO;
-  p->pid = nextpid++;
-
-  release(&ptable.lock);
+  allocpid(p);
 
   // Allocate kernel stack.
   if((p->kstack = kalloc()) == 0){
-    p->state = UNUSED;
+    unallocproc(p);
     return 0;
   }
   sp = p->kstack + KSTACKSIZE;
@@ -180,13 +852,27 @@ found:
   p->context->eip = (uint)forkret;
 
   p->entered_queue = ticks;
-  p->queue = 1;
+  p->queue = RR_QUEUE;
   p->executed_cycle = 0;
   p->priority_ratio = 1;
   p->arrival_time_ratio = 1;
   p->executed_cycle_ratio = 1;
   p->priority = 1;
   p->tickets = generate_random_number(1, DEFAULT_MAX_TICKETS);
+  p->heap_index = -1;
+  p->affinity = (1 << ncpu) - 1;
+  p->last_cpu = -1;
+  p->leader = p;
+  p->nthreads = 0;
+  p->pi_queue = 0;
+  p->pi_nsem = 0;
+  p->edf_period = p->edf_runtime = p->edf_util = 0;
+  p->edf_misses = 0;
+  p->woken = 0;
+  p->run_cycles = p->wait_cycles = 0;
+  p->nvcsw = p->nivcsw = 0;
+  memset(p->wakeup_lat, 0, sizeof(p->wakeup_lat));
+  update_rank(p);
 
   return p;
 }
@@ -205,6 +891,8 @@ userinit(void)
   if((p->pgdir = setupkvm()) == 0)
     panic("userinit: out of memory?");
   inituvm(p->pgdir, _binary_initcode_start, (int)_binary_initcode_size);
+  if(mapkinfo(p->pgdir, p) < 0)
+    panic("userinit: out of memory?");
   p->sz = PGSIZE;
   memset(p->tf, 0, sizeof(*p->tf));
   p->tf->cs = (SEG_UCODE << 3) | DPL_USER;
@@ -219,35 +907,43 @@ userinit(void)
   p->cwd = namei("/");
 
   // this assignment to p->state lets other cores
-  // run this process. the acquire forces the above
+  // run this process. the release forces the above
   // writes to be visible, and the lock is also needed
   // because the assignment might not be atomic.
-  acquire(&ptable.lock);
-
-  p->state = RUNNABLE;
+  make_runnable(p, least_loaded_cpu(p->affinity));
+  kick_cpu(p);
 
-  release(&ptable.lock);
+  release(&p->lock);
 }
 
 // Grow current process's memory by n bytes.
-// Return 0 on success, -1 on failure.
+// Return the old size on success, -1 on failure.
+// Memory is not given back while the process has threads,
+// since they may still have the pages in another CPU's TLB.
 int
 growproc(int n)
 {
-  uint sz;
+  uint sz, oldsz;
   struct proc *curproc = myproc();
+  struct proc *leader = curproc->leader;
 
-  sz = curproc->sz;
+  acquire(&leader->tlock);
+  sz = oldsz = leader->sz;
   if(n > 0){
     if((sz = allocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+      goto bad;
   } else if(n < 0){
-    if((sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
-      return -1;
+    if(leader->nthreads > 0 || (sz = deallocuvm(curproc->pgdir, sz, sz + n)) == 0)
+      goto bad;
   }
-  curproc->sz = sz;
+  leader->sz = sz;
+  release(&leader->tlock);
   switchuvm(curproc);
-  return 0;
+  return oldsz;
+
+bad:
+  release(&leader->tlock);
+  return -1;
 }
 
 // Create a new process copying p as the parent.
@@ -259,6 +955,7 @@ fork(void)
   int i, pid;
   struct proc *np;
   struct proc *curproc = myproc();
+  struct proc *leader = curproc->leader;
 
   // Allocate process.
   if((np = allocproc()) == 0){
@@ -266,40 +963,231 @@ fork(void)
   }
 
   // Copy process state from proc.
-  if((np->pgdir = copyuvm(curproc->pgdir, curproc->sz)) == 0){
+  acquire(&leader->tlock);
+  if((np->pgdir = copyuvm(curproc->pgdir, leader->sz)) == 0 ||
+     mapkinfo(np->pgdir, np) < 0){
+    release(&leader->tlock);
+    if(np->pgdir)
+      freevm(np->pgdir);
+    np->pgdir = 0;
+    if(np->pkinfo)
+      kfree((char*)np->pkinfo);
+    np->pkinfo = 0;
     kfree(np->kstack);
     np->kstack = 0;
-    np->state = UNUSED;
+    unallocproc(np);
     return -1;
   }
-  np->sz = curproc->sz;
-  np->parent = curproc;
+  np->sz = leader->sz;
+  for(i = 0; i < NOFILE; i++)
+    if(leader->ofile[i])
+      np->ofile[i] = filedup(leader->ofile[i]);
+  release(&leader->tlock);
+  // The child does not share an EDF reservation.
+  np->affinity = curproc->queue == EDF_QUEUE ? (1 << ncpu) - 1 : curproc->affinity;
   *np->tf = *curproc->tf;
 
   // Clear %eax so that fork returns 0 in the child.
   np->tf->eax = 0;
 
-  for(i = 0; i < NOFILE; i++)
-    if(curproc->ofile[i])
-      np->ofile[i] = filedup(curproc->ofile[i]);
   np->cwd = idup(curproc->cwd);
 
   safestrcpy(np->name, curproc->name, sizeof(curproc->name));
 
   pid = np->pid;
 
-  acquire(&ptable.lock);
+  release(&np->lock);
 
-  np->state = RUNNABLE;
+  acquire(&wait_lock);
+  np->parent = curproc;
+  sibling_insert(&curproc->children, np);
+  release(&wait_lock);
 
-  release(&ptable.lock);
+  acquire(&np->lock);
+  make_runnable(np, least_loaded_cpu(np->affinity));
+  kick_cpu(np);
+  release(&np->lock);
 
   return pid;
 }
 
+// Free a reaped zombie's remaining resources.
+// Caller must hold wait_lock and p->lock and have
+// unlinked p from its parent's zombie list.
+static void
+freeproc(struct proc *p)
+{
+  kfree(p->kstack);
+  p->kstack = 0;
+  if(p->leader == p){  // threads leave it to their leader
+    freevm(p->pgdir);
+    if(p->pkinfo)
+      kfree((char*)p->pkinfo);
+    p->pkinfo = 0;
+  }
+  p->pgdir = 0;
+  pid_remove(p);
+  p->pid = 0;
+  p->parent = 0;
+  p->name[0] = 0;
+  p->killed = 0;
+  p->state = UNUSED;
+}
+
+// Start a thread that shares the caller's address space
+// and open files, running fn(arg) on the one-page user stack
+// at stack. The thread belongs to the caller's leader and
+// is reaped by join(). Returns its pid, or -1.
+int
+clone(void (*fn)(void*), void *arg, void *stack)
+{
+  struct proc *np;
+  struct proc *curproc = myproc();
+  struct proc *leader = curproc->leader;
+  uint sp, ustack[2];
+  int pid;
+
+  sp = (uint)stack + PGSIZE;
+  if(sp < (uint)stack || sp > leader->sz)
+    return -1;
+  if((np = allocproc()) == 0)
+    return -1;
+
+  // Call fn(arg) with a return address that faults.
+  ustack[0] = 0xffffffff;
+  ustack[1] = (uint)arg;
+  sp -= sizeof(ustack);
+  if(copyout(curproc->pgdir, sp, ustack, sizeof(ustack)) < 0){
+    kfree(np->kstack);
+    np->kstack = 0;
+    unallocproc(np);
+    return -1;
+  }
+
+  np->pgdir = curproc->pgdir;
+  np->leader = leader;
+  np->ustack = stack;
+  np->affinity = curproc->queue == EDF_QUEUE ? (1 << ncpu) - 1 : curproc->affinity;
+  *np->tf = *curproc->tf;
+  np->tf->esp = sp;
+  np->tf->eip = (uint)fn;
+  np->cwd = idup(curproc->cwd);
+  safestrcpy(np->name, curproc->name, sizeof(curproc->name));
+
+  pid = np->pid;
+
+  release(&np->lock);
+
+  acquire(&wait_lock);
+  np->parent = leader;
+  if(leader->nthreads++ == 0 && leader->pkinfo){
+    // getpid() can no longer tell the threads apart by the page.
+    leader->pkinfo->pid = 0;
+    leader->pkinfo->cpu = -1;
+  }
+  release(&wait_lock);
+
+  acquire(&np->lock);
+  make_runnable(np, least_loaded_cpu(np->affinity));
+  kick_cpu(np);
+  release(&np->lock);
+
+  return pid;
+}
+
+// Kill every thread of leader.
+static void
+kill_threads(struct proc *leader)
+{
+  struct proc *p;
+  int pid;
+
+  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
+    if(p == leader)
+      continue;
+    acquire(&p->lock);
+    pid = p->state != UNUSED && p->leader == leader ? p->pid : 0;
+    release(&p->lock);
+    if(pid)
+      kill(pid);
+  }
+}
+
+// Take a joinable thread off leader's list and free it,
+// returning its pid. Caller must hold wait_lock.
+static int
+reap_thread(struct proc *leader, char **stack)
+{
+  struct proc *p;
+  int pid;
+
+  p = leader->thread_zombies;
+  sibling_remove(&leader->thread_zombies, p);
+  leader->nthreads--;
+  // Its lock is held until it is off its kernel stack.
+  acquire(&p->lock);
+  pid = p->pid;
+  *stack = p->ustack;
+  freeproc(p);
+  release(&p->lock);
+  return pid;
+}
+
+// An exiting leader takes its threads down with it, since
+// they run in its address space. A thread cloned while
+// this runs is made by a killed thread, whose own exit
+// wakes us to look again.
+static void
+end_threads(struct proc *leader)
+{
+  char *stack;
+
+  acquire(&wait_lock);
+  while(leader->nthreads > 0){
+    while(leader->thread_zombies)
+      reap_thread(leader, &stack);
+    if(leader->nthreads == 0)
+      break;
+    release(&wait_lock);
+    kill_threads(leader);
+    acquire(&wait_lock);
+    if(leader->thread_zombies == 0)
+      sleep(leader, &wait_lock);
+  }
+  release(&wait_lock);
+}
+
+// Wait for a thread of the caller's group to exit and
+// return its pid, storing the stack it was cloned with in
+// *stack. Return -1 if there is no other thread.
+int
+join(void **stack)
+{
+  struct proc *curproc = myproc();
+  struct proc *leader = curproc->leader;
+  char *ustack;
+  int pid;
+
+  acquire(&wait_lock);
+  for(;;){
+    if(leader->thread_zombies){
+      pid = reap_thread(leader, &ustack);
+      release(&wait_lock);
+      *stack = ustack;
+      return pid;
+    }
+    if(leader->nthreads == (curproc != leader) || curproc->killed){
+      release(&wait_lock);
+      return -1;
+    }
+    sleep(leader, &wait_lock);
+  }
+}
+
 // Exit the current process.  Does not return.
 // An exited process remains in the zombie state
 // until its parent calls wait() to find out it exited.
+// A thread exits alone and waits for join() instead.
 void
 exit(void)
 {
@@ -310,7 +1198,17 @@ exit(void)
   if(curproc == initproc)
     panic("init exiting");
 
-  // Close all open files.
+  if(curproc->leader == curproc)
+    end_threads(curproc);
+
+  acquire(&curproc->lock);
+  if(curproc->queue == EDF_QUEUE){
+    edf_unreserve(curproc);
+    curproc->queue = RR_QUEUE;
+  }
+  release(&curproc->lock);
+
+  // Close all open files. A thread has none of its own.
   for(fd = 0; fd < NOFILE; fd++){
     if(curproc->ofile[fd]){
       fileclose(curproc->ofile[fd]);
@@ -323,22 +1221,39 @@ exit(void)
   end_op();
   curproc->cwd = 0;
 
-  acquire(&ptable.lock);
-
-  // Parent might be sleeping in wait().
-  wakeup1(curproc->parent);
+  acquire(&wait_lock);
 
   // Pass abandoned children to init.
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->parent == curproc){
+  while((p = curproc->children) != 0){
+    sibling_remove(&curproc->children, p);
+    p->parent = initproc;
+    sibling_insert(&initproc->children, p);
+  }
+  if(curproc->zombies){
+    while((p = curproc->zombies) != 0){
+      sibling_remove(&curproc->zombies, p);
       p->parent = initproc;
-      if(p->state == ZOMBIE)
-        wakeup1(initproc);
+      sibling_insert(&initproc->zombies, p);
     }
+    wakeup(initproc);
   }
 
-  // Jump into the scheduler, never to return.
+  // Parent might be sleeping in wait().
+  wakeup(curproc->parent);
+
+  acquire(&curproc->lock);
+
   curproc->state = ZOMBIE;
+  if(curproc->leader != curproc)
+    sibling_insert(&curproc->parent->thread_zombies, curproc);
+  else {
+    sibling_remove(&curproc->parent->children, curproc);
+    sibling_insert(&curproc->parent->zombies, curproc);
+  }
+
+  release(&wait_lock);
+
+  // Jump into the scheduler, never to return.
   sched();
   panic("zombie exit");
 }
@@ -349,41 +1264,62 @@ int
 wait(void)
 {
   struct proc *p;
-  int havekids, pid;
+  int pid;
   struct proc *curproc = myproc();
   
-  acquire(&ptable.lock);
+  acquire(&wait_lock);
   for(;;){
-    // Scan through table looking for exited children.
-    havekids = 0;
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-      if(p->parent != curproc)
-        continue;
-      havekids = 1;
-      if(p->state == ZOMBIE){
-        // Found one.
-        pid = p->pid;
-        kfree(p->kstack);
-        p->kstack = 0;
-        freevm(p->pgdir);
-        p->pid = 0;
-        p->parent = 0;
-        p->name[0] = 0;
-        p->killed = 0;
-        p->state = UNUSED;
-        release(&ptable.lock);
-        return pid;
-      }
+    // Exited children are already on their own list.
+    if((p = curproc->zombies) != 0){
+      sibling_remove(&curproc->zombies, p);
+      // Its lock is held until it is off its kernel stack.
+      acquire(&p->lock);
+      pid = p->pid;
+      freeproc(p);
+      release(&p->lock);
+      release(&wait_lock);
+      return pid;
     }
 
-    // No point waiting if we don't have any children.
-    if(!havekids || curproc->killed){
-      release(&ptable.lock);
+    // No point waiting if we don't have any children.
+    if(curproc->children == 0 || curproc->killed){
+      release(&wait_lock);
+      return -1;
+    }
+
+    // Wait for children to exit.  (See wakeup call in proc_exit.)
+    sleep(curproc, &wait_lock);  //DOC: wait-sleep
+  }
+}
+
+// Wait for the child with the given pid to exit.
+// Return its pid, or -1 if it is not a child of ours.
+// Threads are reaped by join().
+int
+waitpid(int pid)
+{
+  struct proc *p;
+  struct proc *curproc = myproc();
+
+  acquire(&wait_lock);
+  for(;;){
+    p = findproc(pid);
+    if(p == 0 || p->parent != curproc || p->leader != p || curproc->killed){
+      if(p)
+        release(&p->lock);
+      release(&wait_lock);
       return -1;
     }
+    if(p->state == ZOMBIE){
+      sibling_remove(&curproc->zombies, p);
+      freeproc(p);
+      release(&p->lock);
+      release(&wait_lock);
+      return pid;
+    }
+    release(&p->lock);
 
-    // Wait for children to exit.  (See wakeup1 call in proc_exit.)
-    sleep(curproc, &ptable.lock);  //DOC: wait-sleep
+    sleep(curproc, &wait_lock);
   }
 }
 
@@ -396,116 +1332,233 @@ wait(void)
 //  - eventually that process transfers control
 //      via swtch back to the scheduler.
 
+// Advance this CPU's aging wheel to the current tick,
+// promoting every process whose deadline has passed, and
+// refill the budget of throttled EDF jobs whose next
+// period has started.
+// Called from the timer interrupt on every CPU.
 void
-fix_queues(void) {
-    struct proc *p;
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->state == RUNNABLE)
-            if (ticks - p->entered_queue >= STARVING_THRESHOLD) {
-                p->queue = 1;
-                p->entered_queue = ticks;
-            }
+aging_tick(void)
+{
+  struct runqueue *rq;
+  struct proc *p, *next;
+  uint now, t;
+
+  rq = &runqueues[cpuid()];
+  now = ticks;
+  if(rq->naging == 0 && rq->throttled == 0){
+    rq->wheel_tick = now;
+    return;
+  }
+
+  acquire(&rq->lock);
+  t = rq->wheel_tick;
+  if(now - t > AGING_WHEEL_SIZE)
+    t = now - AGING_WHEEL_SIZE;
+  while(t != now){
+    t++;
+    while((p = rq->wheel[t % AGING_WHEEL_SIZE]) != 0 && p->age_deadline <= now){
+      dequeue_proc(p);
+      promote(rq, p);
+      enqueue_proc(p, rq - runqueues);
+    }
+  }
+  rq->wheel_tick = now;
+
+  for(p = rq->throttled; p; p = next){
+    next = p->rq_next;
+    if(p->edf_deadline <= now){
+      dequeue_proc(p);
+      while(p->edf_deadline <= now)
+        p->edf_deadline += p->edf_period;
+      p->edf_budget = p->edf_runtime;
+      enqueue_proc(p, rq - runqueues);
     }
+  }
+  release(&rq->lock);
 }
 
+// Change the aging threshold and requeue every waiting
+// lower-level process under its new deadline.
+int
+set_starving_threshold(int threshold)
+{
+  struct runqueue *rq;
+  struct proc *p;
+  int q, n;
 
-struct proc* round_robin(void) { // for queue 1 with the highest priority
-    struct proc *p;
-    struct proc *min_p = 0;
-    int time = ticks;
-    int starvation_time = 0;
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->state != RUNNABLE || p->queue != 1)
-            continue;
-            
-        if (p->state != RUNNABLE || p->queue != 1)
-            continue;
+  if(threshold <= 0)
+    return -1;
 
-        int starved_for = time - p->entered_queue;
-        if (starved_for > starvation_time) {
-            starvation_time = starved_for;
-            min_p = p;
-        }
+  starving_threshold = threshold;
+  for(rq = runqueues; rq < &runqueues[ncpu]; rq++){
+    acquire(&rq->lock);
+    for(q = LOTTERY_QUEUE - 1; q < NQUEUE; q++){
+      for(n = rq->count[q]; n > 0; n--){
+        p = rq->head[q];
+        dequeue_proc(p);
+        enqueue_proc(p, rq - runqueues);
+      }
     }
-    return min_p;
+    release(&rq->lock);
+  }
+  return 0;
 }
 
-float
-get_rank(struct proc* p)
-{
-  return 
-    p->priority * p->priority_ratio
-    + p->entered_queue * p->arrival_time_ratio
-    + p->executed_cycle * p->executed_cycle_ratio;
+// Round robin: the level list is kept in arrival order,
+// so the head is the process that has waited longest.
+struct proc* round_robin(struct runqueue *rq) { // for queue 1 with the highest priority
+    return rq->head[RR_QUEUE - 1];
 }
 
+// BJF: the level is a min-heap on the cached rank, so the
+// best job is always at its root.
 struct proc*
-bjf(void)
+bjf(struct runqueue *rq)
 {
-  struct proc* p;
-  struct proc* min_p = 0;
-  float min_rank = MIN_BJF_RANK;
+  return rq->bjf_heap[0];
+}
 
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){ 
-    if (p->state != RUNNABLE || p->queue != 3)
-      continue;
-    if (get_rank(p) < min_rank){
-      min_p = p;
-      min_rank = get_rank(p);
-    }
-  }
+// Lottery: draw a ticket and look its holder up in the
+// run queue's ticket tree, O(log NPROC).
+struct proc* lottery(struct runqueue *rq) { // for queue #2 and entrance queue
+    if (rq->tickets <= 0)
+        return rq->head[LOTTERY_QUEUE - 1];
+    int winning_ticket = generate_random_number(1, rq->tickets);
+    return &ptable.proc[ticket_find(rq, winning_ticket)];
+}
 
-  return min_p;
+// Take one process that may run on rq's CPU off the
+// busiest other run queue, preferring its highest level.
+// Caller must not hold rq->lock, so that two CPUs stealing
+// from each other cannot deadlock.
+static struct proc*
+steal(struct runqueue *rq)
+{
+  struct runqueue *victim;
+  struct proc *p;
+  uint levels, bit;
+
+  if((victim = busiest_runqueue(rq)) == 0)
+    return 0;
+  bit = 1 << (rq - runqueues);
+  p = 0;
+  acquire(&victim->lock);
+  for(levels = victim->levels; levels && p == 0; levels &= levels - 1)
+    for(p = victim->head[bsf(levels)]; p; p = p->rq_next)
+      if(p->affinity & bit)
+        break;
+  if(p)
+    dequeue_proc(p);
+  release(&victim->lock);
+  return p;
 }
 
-struct proc* lottery(void) { // for queue #2 and entrance queue
-    struct proc *p;
-    int total_tickets = 0;
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->state != RUNNABLE || p->queue != 2)
-            continue;
-        total_tickets += p->tickets;
-    }
-    int winning_ticket = generate_random_number(1, total_tickets);
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
-        if (p->state != RUNNABLE || p->queue != 2)
-            continue;
-        winning_ticket -= p->tickets;
-        if (winning_ticket <= 0)
-            return p;
-    }
+// Choose the next process to run on rq's CPU and take
+// it off the run queue, or return 0 if rq is empty. EDF
+// jobs come before all three levels.
+// Caller must hold rq->lock.
+static struct proc*
+pick_next(struct runqueue *rq)
+{
+  struct proc *p;
+
+  if(rq->edf){
+    p = rq->edf;
+    dequeue_proc(p);
+    return p;
+  }
+  if(rq->levels == 0)
     return 0;
+
+  switch(bsf(rq->levels) + 1){
+  case RR_QUEUE:
+    p = round_robin(rq);
+    break;
+  case LOTTERY_QUEUE:
+    p = lottery(rq);
+    break;
+  default:
+    p = bjf(rq);
+    break;
+  }
+  dequeue_proc(p);
+  return p;
+}
+
+// p is about to run: charge the time it spent waiting
+// and, if a wakeup made it runnable, record the latency.
+// Caller must hold p->lock.
+static void
+account_run(struct proc *p)
+{
+  uint64 now, lat;
+  uint b;
+
+  now = rdtsc();
+  lat = now - p->stat_tsc;
+  p->wait_cycles += lat;
+  if(p->woken){
+    b = (lat >> 32) ? 32 + bsr(lat >> 32) : (uint)lat ? bsr(lat) : 0;
+    if(b >= NLATBUCKET)
+      b = NLATBUCKET - 1;
+    p->wakeup_lat[b]++;
+    p->woken = 0;
+  }
+  p->stat_tsc = now;
 }
 
 void
 scheduler(void) {
     struct proc *p;
+    int pid;
+    uint missed;
     struct cpu *c = mycpu();
+    struct runqueue *rq = &runqueues[cpuid()];
     c->proc = 0;
 
     for (;;) {
         // Enable interrupts on this processor.
         sti();
 
-        // Loop over process table looking for process to run.
-        acquire(&ptable.lock);
-        fix_queues();
-        p = round_robin();
-        if (p == 0)
-            p = lottery();
-        if (p == 0)
-            p = bjf();
-        if (p == 0) {
-            release(&ptable.lock);
+        // Stay off the run queue locks until some run queue
+        // has work, so idle CPUs don't contend with busy ones;
+        // halt rather than spin while there is none.
+        if (rq->nrunnable == 0 && busiest_runqueue(rq) == 0) {
+            idle(c, rq);
+            continue;
+        }
+
+        acquire(&rq->lock);
+        p = pick_next(rq);
+        release(&rq->lock);
+        if (p == 0 && (p = steal(rq)) == 0)
             continue;
+
+        // p is off every run queue now, so nothing else will
+        // change its state. Its lock may still be held by the
+        // CPU it last ran on until that CPU is off p's stack.
+        acquire(&p->lock);
+        if (p->state != RUNNABLE)
+            panic("scheduler: not runnable");
+        pid = p->pid;
+        missed = 0;
+        if (p->queue == EDF_QUEUE && p->edf_deadline <= ticks) {
+            missed = p->edf_deadline;
+            edf_miss(p);
         }
         p->entered_queue = ticks;
+        p->cpu = p->last_cpu = rq - runqueues;
+        p->slice_used = 0;
+        update_rank(p);
+        account_run(p);
 
         // Switch to chosen process.  It is the process's job
-        // to release ptable.lock and then reacquire it
+        // to release its lock and then reacquire it
         // before jumping back to us.
         c->proc = p;
         switchuvm(p);
+        kinfo_switch(p);
         p->state = RUNNING;
 
         swtch(&(c->scheduler), p->context);
@@ -514,11 +1567,14 @@ scheduler(void) {
         // Process is done running for now.
         // It should have changed its p->state before coming back.
         c->proc = 0;
-        release(&ptable.lock);
+        release(&p->lock);
+
+        if (missed)
+            edf_report(pid, missed);
     }
 }
 
-// Enter scheduler.  Must hold only ptable.lock
+// Enter scheduler.  Must hold only p->lock
 // and have changed proc->state. Saves and restores
 // intena because intena is a property of this
 // kernel thread, not this CPU. It should
@@ -529,30 +1585,108 @@ void
 sched(void)
 {
   int intena;
+  uint64 now;
   struct proc *p = myproc();
 
-  if(!holding(&ptable.lock))
-    panic("sched ptable.lock");
+  if(!holding(&p->lock))
+    panic("sched p->lock");
   if(mycpu()->ncli != 1)
     panic("sched locks");
   if(p->state == RUNNING)
     panic("sched running");
   if(readeflags()&FL_IF)
     panic("sched interruptible");
+  now = rdtsc();
+  p->run_cycles += now - p->stat_tsc;
+  p->stat_tsc = now;
+  if(p->state == RUNNABLE)
+    p->nivcsw++;
   intena = mycpu()->intena;
   swtch(&p->context, mycpu()->scheduler);
   mycpu()->intena = intena;
 }
 
 // Give up the CPU for one scheduling round.
+// Caller must hold p->lock.
+static void
+yield1(struct proc *p)
+{
+  make_runnable(p, cpuid());
+  if(p->cpu != cpuid())  // no longer allowed here
+    kick_cpu(p);
+  sched();
+}
+
 void
 yield(void)
 {
-  acquire(&ptable.lock);  //DOC: yieldlock
-  myproc()->state = RUNNABLE;
-  myproc()->executed_cycle += 0.1;
-  sched();
-  release(&ptable.lock);
+  struct proc *p = myproc();
+
+  acquire(&p->lock);  //DOC: yieldlock
+  yield1(p);
+  release(&p->lock);
+}
+
+// Charge the running process for a timer tick. It gives up
+// the CPU once it has used its level's whole time slice,
+// moving a level down if that level demotes, or sooner if
+// a higher level has work waiting on this CPU. A process
+// that blocks before its slice is up keeps its level.
+void
+sched_tick(void)
+{
+  struct proc *p = myproc();
+  struct runqueue *rq;
+  uint missed;
+  int q;
+
+  acquire(&p->lock);
+  p->executed_cycle++;
+  update_rank(p);
+  rq = &runqueues[p->cpu];
+
+  // An EDF job runs until its budget is spent, it misses
+  // its deadline, or a job with an earlier deadline waits.
+  if(p->queue == EDF_QUEUE){
+    missed = 0;
+    if(--p->edf_budget <= 0){
+      p->edf_budget = 0;
+      yield1(p);
+    } else if(p->edf_deadline <= ticks){
+      missed = p->edf_deadline;
+      edf_miss(p);
+    } else if(rq->edf && rq->edf->edf_deadline < p->edf_deadline)
+      yield1(p);
+    release(&p->lock);
+    if(missed)
+      edf_report(p->pid, missed);
+    return;
+  }
+
+  q = p->queue - 1;
+  if(++p->slice_used >= quantum[q]){
+    if(demote[q] && p->queue < NQUEUE && !p->pi_queue){
+      p->queue++;
+      update_rank(p);
+    }
+    yield1(p);
+  } else if(rq->edf || (rq->levels & ((1 << q) - 1)))
+    yield1(p);
+  release(&p->lock);
+}
+
+// Set a level's time slice in ticks and whether using it
+// all up demotes; -1 leaves either unchanged.
+int
+set_quantum(int queue, int slice, int demotes)
+{
+  if(queue < RR_QUEUE || queue > NQUEUE || slice == 0 || slice < -1)
+    return -1;
+  if(slice != -1)
+    quantum[queue - 1] = slice;
+  if(demotes != -1)
+    demote[queue - 1] = demotes != 0;
+  return 0;
 }
 
 // A fork child's very first scheduling by scheduler()
@@ -561,8 +1695,8 @@ void
 forkret(void)
 {
   static int first = 1;
-  // Still holding ptable.lock from scheduler.
-  release(&ptable.lock);
+  // Still holding p->lock from scheduler.
+  release(&myproc()->lock);
 
   if (first) {
     // Some initialization functions must be run in the context
@@ -576,12 +1710,52 @@ forkret(void)
   // Return to "caller", actually trapret (see allocproc).
 }
 
+// Wait channels. Each bucket's lock protects its list and,
+// for the processes on it, their chan.
+
+static int
+sleepq_hash(void *chan)
+{
+  return ((uint)chan * 2654435761U) >> 26;  // top 6 bits: NSLEEPQ buckets
+}
+
+static void
+sleepq_insert(struct proc *p)
+{
+  int h = sleepq_hash(p->chan);
+
+  p->sleep_next = 0;
+  p->sleep_prev = sleepq[h].tail;
+  if(sleepq[h].tail)
+    sleepq[h].tail->sleep_next = p;
+  else
+    sleepq[h].head = p;
+  sleepq[h].tail = p;
+}
+
+static void
+sleepq_remove(struct proc *p)
+{
+  int h = sleepq_hash(p->chan);
+
+  if(p->sleep_prev)
+    p->sleep_prev->sleep_next = p->sleep_next;
+  else
+    sleepq[h].head = p->sleep_next;
+  if(p->sleep_next)
+    p->sleep_next->sleep_prev = p->sleep_prev;
+  else
+    sleepq[h].tail = p->sleep_prev;
+  p->sleep_next = p->sleep_prev = 0;
+}
+
 // Atomically release lock and sleep on chan.
 // Reacquires lock when awakened.
 void
 sleep(void *chan, struct spinlock *lk)
 {
   struct proc *p = myproc();
+  struct sleepq *sq;
   
   if(p == 0)
     panic("sleep");
@@ -589,19 +1763,23 @@ sleep(void *chan, struct spinlock *lk)
   if(lk == 0)
     panic("sleep without lk");
 
-  // Must acquire ptable.lock in order to
-  // change p->state and then call sched.
-  // Once we hold ptable.lock, we can be
+  // Must acquire chan's bucket lock and p->lock in order
+  // to change p->state and then call sched.
+  // Once we hold the bucket lock, we can be
   // guaranteed that we won't miss any wakeup
-  // (wakeup runs with ptable.lock locked),
+  // (wakeup runs with the bucket locked),
   // so it's okay to release lk.
-  if(lk != &ptable.lock){  //DOC: sleeplock0
-    acquire(&ptable.lock);  //DOC: sleeplock1
-    release(lk);
-  }
+  sq = &sleepq[sleepq_hash(chan)];
+  acquire(&sq->lock);  //DOC: sleeplock1
+  acquire(&p->lock);
+  release(lk);
+
   // Go to sleep.
   p->chan = chan;
   p->state = SLEEPING;
+  p->nvcsw++;
+  sleepq_insert(p);
+  release(&sq->lock);
 
   sched();
 
@@ -609,31 +1787,120 @@ sleep(void *chan, struct spinlock *lk)
   p->chan = 0;
 
   // Reacquire original lock.
-  if(lk != &ptable.lock){  //DOC: sleeplock2
-    release(&ptable.lock);
-    acquire(lk);
-  }
+  release(&p->lock);
+  acquire(lk);
 }
 
-//PAGEBREAK!
-// Wake up all processes sleeping on chan.
-// The ptable lock must be held.
+// Make a sleeping process runnable. Caller must hold the
+// lock of p's bucket and p->lock.
 static void
-wakeup1(void *chan) {
-    struct proc *p;
+wakeproc(struct proc *p)
+{
+  sleepq_remove(p);
+  p->woken = 1;
+  make_runnable(p, p->cpu);
+  kick_cpu(p);
+}
 
-    for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-        if (p->state == SLEEPING && p->chan == chan)
-            p->state = RUNNABLE;
+//PAGEBREAK!
+// Wake up at most n processes sleeping on chan, longest
+// sleeper first. Only chan's hash bucket is searched.
+// Returns the number woken.
+static int
+wakeupn(void *chan, int n)
+{
+  struct sleepq *sq;
+  struct proc *p, *next;
+  int woken;
+
+  woken = 0;
+  sq = &sleepq[sleepq_hash(chan)];
+  acquire(&sq->lock);
+  for(p = sq->head; p && woken < n; p = next){
+    next = p->sleep_next;
+    if(p->chan != chan)
+      continue;
+    // p may still be on its way into sched(); its lock
+    // is free once it is off the CPU.
+    acquire(&p->lock);
+    wakeproc(p);
+    release(&p->lock);
+    woken++;
+  }
+  release(&sq->lock);
+  return woken;
 }
 
 // Wake up all processes sleeping on chan.
 void
 wakeup(void *chan)
 {
-  acquire(&ptable.lock);
-  wakeup1(chan);
-  release(&ptable.lock);
+  wakeupn(chan, NPROC);
+}
+
+// Wake up only the longest sleeper on chan. For channels
+// where every waiter competes for the same thing, so
+// waking them all would just put most back to sleep.
+void
+wakeup_one(void *chan)
+{
+  wakeupn(chan, 1);
+}
+
+// A futex is named by the kernel address of its user word,
+// which is fixed by the physical page it is on, so every
+// address space mapping that page agrees on it. Returns 0
+// if uaddr is not a mapped, aligned user word.
+static uint*
+futex_key(uint *uaddr)
+{
+  char *page;
+
+  if((uint)uaddr % sizeof(uint))
+    return 0;
+  if((page = uva2ka(myproc()->pgdir, (char*)PGROUNDDOWN((uint)uaddr))) == 0)
+    return 0;
+  return (uint*)(page + (uint)uaddr % PGSIZE);
+}
+
+// Sleep until futex_wake on uaddr, unless *uaddr is no
+// longer val. Returns 0 when woken, -1 if the word changed
+// or uaddr is bad.
+int
+futex_wait(uint *uaddr, uint val)
+{
+  struct spinlock *lk;
+  uint *key;
+
+  if((key = futex_key(uaddr)) == 0)
+    return -1;
+  lk = &futexq[sleepq_hash(key)];
+  acquire(lk);
+  if(*key != val || myproc()->killed){
+    release(lk);
+    return -1;
+  }
+  sleep(key, lk);
+  release(lk);
+  return 0;
+}
+
+// Wake at most n waiters on uaddr, longest first. Returns
+// the number woken, or -1 if uaddr is bad.
+int
+futex_wake(uint *uaddr, int n)
+{
+  struct spinlock *lk;
+  uint *key;
+  int woken;
+
+  if((key = futex_key(uaddr)) == 0)
+    return -1;
+  lk = &futexq[sleepq_hash(key)];
+  acquire(lk);
+  woken = wakeupn(key, n);
+  release(lk);
+  return woken;
 }
 
 // Kill the process with the given pid.
@@ -643,20 +1910,30 @@ int
 kill(int pid)
 {
   struct proc *p;
+  struct sleepq *sq;
+  void *chan;
 
-  acquire(&ptable.lock);
-  for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){
-    if(p->pid == pid){
-      p->killed = 1;
-      // Wake process from sleep if necessary.
-      if(p->state == SLEEPING)
-        p->state = RUNNABLE;
-      release(&ptable.lock);
-      return 0;
+  if((p = findproc(pid)) == 0)
+    return -1;
+  p->killed = 1;
+  // Wake process from sleep if necessary. The bucket lock
+  // comes before p->lock, so let go of p and check again.
+  while(p->state == SLEEPING){
+    chan = p->chan;
+    release(&p->lock);
+    sq = &sleepq[sleepq_hash(chan)];
+    acquire(&sq->lock);
+    acquire(&p->lock);
+    if(p->pid != pid){
+      release(&sq->lock);
+      break;
     }
+    if(p->state == SLEEPING && p->chan == chan)
+      wakeproc(p);
+    release(&sq->lock);
   }
-  release(&ptable.lock);
-  return -1;
+  release(&p->lock);
+  return 0;
 }
 
 //PAGEBREAK: 36
@@ -687,6 +1964,8 @@ procdump(void)
     else
       state = "???";
     cprintf("%d %s %s", p->pid, state, p->name);
+    if(p->last_cpu >= 0)
+      cprintf(" cpu %d", p->last_cpu);
     if(p->state == SLEEPING){
       getcallerpcs((uint*)p->context->ebp+2, pc);
       for(i=0; i<10 && pc[i] != 0; i++)
@@ -736,113 +2015,428 @@ find_largest_prime_factor(int n)
 }
 
 
-int syscalls_pid_stack[NUM_OF_SYSCALLS][MAX_PID_NUM_SAVED];
-int syscalls_order_pid_stack[NUM_OF_SYSCALLS][MAX_PID_NUM_SAVED];
-int pid_num_of_calls[MAX_PID_TRACED];
+// Scheduler parameter setters for one process.
+// Caller must hold p->lock and its run queue's lock.
+
+static void
+setqueue(struct proc *p, int queue)
+{
+  if (p->queue == EDF_QUEUE)  // leaves its class only through set_deadline
+    return;
+  if (p->onrq) {
+    dequeue_proc(p);
+    p->queue = queue;
+    enqueue_proc(p, p->cpu);
+  } else
+    p->queue = queue;
+}
+
+// The level p runs at while boosted: its own, or that of
+// the highest waiter on a semaphore it holds.
+static int
+pi_level(struct proc *p)
+{
+  int i, q;
+
+  q = p->pi_queue;
+  for(i = 0; i < p->pi_nsem; i++)
+    if(p->pi_level[i] < q)
+      q = p->pi_level[i];
+  return q;
+}
+
+// Set p's own level. While p is boosted, that is the level
+// it goes back to, and it keeps any higher one it inherited.
+static void
+setbase(struct proc *p, int queue)
+{
+  if(p->pi_nsem > 0){
+    p->pi_queue = queue;
+    queue = pi_level(p);
+  }
+  setqueue(p, queue);
+}
+
+static void
+settickets(struct proc *p, int tickets)
+{
+  if (p->onrq && p->queue == LOTTERY_QUEUE) {
+    int old = ticket_weight(p);
+    p->tickets = tickets;
+    ticket_update(&runqueues[p->cpu], p - ptable.proc, ticket_weight(p) - old);
+  } else
+    p->tickets = tickets;
+}
+
+static void
+setbjf(struct proc *p, int priority_ratio, int arrival_time_ratio, int executed_cycle_ratio)
+{
+  p->priority_ratio = priority_ratio;
+  p->arrival_time_ratio = arrival_time_ratio;
+  p->executed_cycle_ratio = executed_cycle_ratio;
+  update_rank(p);
+}
 
 void
-push_pid_in_stack(int pid,int num)
+set_proc_queue(int pid, int queue)
 {
-    int i;
-    for (i = 0; syscalls_pid_stack[num][i]!=0; i++) {}
-    syscalls_pid_stack[num][i] = pid;
-    syscalls_order_pid_stack[num][i] = ++pid_num_of_calls[pid];
+  struct proc *p;
+  struct runqueue *rq;
+
+  if (queue < RR_QUEUE || queue > NQUEUE)
+    return;
+
+  if ((p = findproc(pid)) == 0)
+    return;
+  rq = lock_runqueue(p);
+  setbase(p, queue);
+  release(&rq->lock);
+  release(&p->lock);
 }
 
+void
+set_lottery_params(int pid, int ticket_chance){
+  struct proc *p;
+  struct runqueue *rq;
+
+  if ((p = findproc(pid)) == 0)
+    return;
+  rq = lock_runqueue(p);
+  settickets(p, ticket_chance);
+  release(&rq->lock);
+  release(&p->lock);
+}
 
-// find the pid callers of a syscall and order that pids called that syscall
 void
-get_callers(int syscall_number)
+set_a_proc_bjf_params(int pid, int priority_ratio, int arrival_time_ratio, int executed_cycle_ratio)
 {
-    if(syscalls_pid_stack[syscall_number][0] == 0) {
-      cprintf("this syscall is not called yet!!!\n");
-      return;
+  struct proc *p;
+  struct runqueue *rq;
+
+  if ((p = findproc(pid)) == 0)
+    return;
+  rq = lock_runqueue(p);
+  setbjf(p, priority_ratio, arrival_time_ratio, executed_cycle_ratio);
+  release(&rq->lock);
+  release(&p->lock);
+}
+
+// Apply a batch of scheduler settings, each entry under
+// one hold of its process's locks. Entries are applied one
+// at a time, so the batch as a whole is not atomic: others
+// may see some entries applied and not yet the rest.
+// Fields left at -1 are not changed; each entry's result
+// is set to 0, or -1 if its pid or queue is invalid.
+// Returns the number of entries applied.
+int
+set_sched_params(struct sched_param *sp, int n)
+{
+  struct proc *p;
+  struct runqueue *rq;
+  int i, applied;
+
+  applied = 0;
+  for (i = 0; i < n; i++, sp++) {
+    if (sp->queue != -1 && (sp->queue < RR_QUEUE || sp->queue > NQUEUE)) {
+      sp->result = -1;
+      continue;
     }
+    if ((p = findproc(sp->pid)) == 0) {
+      sp->result = -1;
+      continue;
+    }
+    rq = lock_runqueue(p);
+    if (sp->queue != -1)
+      setbase(p, sp->queue);
+    if (sp->tickets != -1)
+      settickets(p, sp->tickets);
+    if (sp->priority_ratio != -1 || sp->arrival_time_ratio != -1 || sp->executed_cycle_ratio != -1)
+      setbjf(p,
+             sp->priority_ratio != -1 ? sp->priority_ratio : p->priority_ratio,
+             sp->arrival_time_ratio != -1 ? sp->arrival_time_ratio : p->arrival_time_ratio,
+             sp->executed_cycle_ratio != -1 ? sp->executed_cycle_ratio : p->executed_cycle_ratio);
+    release(&rq->lock);
+    release(&p->lock);
+    sp->result = 0;
+    applied++;
+  }
+  return applied;
+}
 
-    cprintf("pid: order that pid called this syscall\n");
-    for (int i = 0; syscalls_pid_stack[syscall_number][i] != 0; i++) {
-
-      if(i%MAX_PID_OUTPUT_IN_ONE_LINE == 0) cprintf("\n");
-      
-      if (syscalls_pid_stack[syscall_number][i+1] != 0)
-        cprintf("%d:%d ,", syscalls_pid_stack[syscall_number][i],
-                           syscalls_order_pid_stack[syscall_number][i]);
-      else
-        cprintf("%d:%d\n", syscalls_pid_stack[syscall_number][i],
-                           syscalls_order_pid_stack[syscall_number][i]);
+// Priority inheritance. While a process waits for a
+// semaphore, the process holding it runs at the waiter's
+// level if that is higher than its own, so that processes
+// on the levels in between cannot keep the waiter waiting.
+static int pi_enabled = 1;
+
+// Turn priority inheritance on or off. Returns whether it
+// was on.
+int
+set_inheritance(int on)
+{
+  int was = pi_enabled;
+
+  pi_enabled = on != 0;
+  return was;
+}
+
+// Raise process pid, which holds semaphore sem, to level
+// queue until it releases sem. Each semaphore's boost is
+// kept apart, so releasing one leaves those of the others.
+// An EDF waiter lends round robin, and an EDF holder needs
+// no help. Boosts through more than NPIBOOST semaphores at
+// once are not made.
+void
+pi_boost(int pid, int queue, int sem)
+{
+  struct proc *p;
+  struct runqueue *rq;
+  int i, base;
+
+  if(!pi_enabled)
+    return;
+  if(queue < RR_QUEUE)
+    queue = RR_QUEUE;
+  if((p = findproc(pid)) == 0)
+    return;
+  // aging_tick() promotes under the run queue lock alone,
+  // so p->queue is only read with it held.
+  rq = lock_runqueue(p);
+  base = p->pi_nsem > 0 ? p->pi_queue : p->queue;
+  for(i = 0; i < p->pi_nsem && p->pi_sem[i] != sem; i++)
+    ;
+  if(p->queue != EDF_QUEUE && queue < base && i < NPIBOOST){
+    if(i == p->pi_nsem){
+      p->pi_nsem++;
+      p->pi_sem[i] = sem;
+      p->pi_level[i] = queue;
+    } else if(queue < p->pi_level[i])
+      p->pi_level[i] = queue;
+    p->pi_queue = base;
+    if(queue < p->queue){
+      setqueue(p, queue);
+      rq->boosts++;
     }
-    
+  }
+  release(&rq->lock);
+  release(&p->lock);
 }
 
+// The caller released semaphore sem; drop the boost it had
+// for it, and run at the highest level it still inherits.
 void
-set_proc_queue(int pid, int queue)
+pi_restore(int sem)
+{
+  struct proc *p = myproc();
+  struct runqueue *rq;
+  int i, queue;
+
+  acquire(&p->lock);
+  rq = lock_runqueue(p);  // promote() may change pi_queue
+  for(i = 0; i < p->pi_nsem && p->pi_sem[i] != sem; i++)
+    ;
+  if(i < p->pi_nsem){
+    p->pi_nsem--;
+    p->pi_sem[i] = p->pi_sem[p->pi_nsem];
+    p->pi_level[i] = p->pi_level[p->pi_nsem];
+    queue = pi_level(p);
+    if(p->pi_nsem == 0)
+      p->pi_queue = 0;
+    setqueue(p, queue);
+  }
+  release(&rq->lock);
+  release(&p->lock);
+}
+
+// Copy the latency counters of up to n processes to st.
+// Returns the number copied.
+int
+procstat(struct procstat *st, int n)
 {
   struct proc *p;
+  int i;
 
-  acquire(&ptable.lock);
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if (p->pid == pid)
-      p->queue = queue;
+  i = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && i < n; p++){
+    acquire(&p->lock);
+    if(p->state != UNUSED){
+      st[i].pid = p->pid;
+      st[i].queue = p->queue;
+      safestrcpy(st[i].name, p->name, sizeof(st[i].name));
+      st[i].run_cycles = p->run_cycles;
+      st[i].wait_cycles = p->wait_cycles;
+      st[i].nvcsw = p->nvcsw;
+      st[i].nivcsw = p->nivcsw;
+      memmove(st[i].wakeup_lat, p->wakeup_lat, sizeof(st[i].wakeup_lat));
+      i++;
+    }
+    release(&p->lock);
   }
-  release(&ptable.lock);
+  return i;
 }
 
-void
-set_lottery_params(int pid, int ticket_chance){
+// Give up this CPU now if the caller may no longer run on
+// it, rather than at its next tick.
+static void
+move_if_disallowed(void)
+{
+  int away;
+
+  pushcli();
+  away = !(myproc()->affinity & (1 << cpuid()));
+  popcli();
+  if (away)
+    yield();
+}
+
+// Restrict a process to the CPUs in mask. A queued process
+// is moved at once; a running one moves the next time it
+// gives up its CPU, which the caller does right away when
+// it has just excluded its own CPU. EDF jobs stay on the
+// CPU they were admitted on.
+int
+set_affinity(int pid, uint mask)
+{
   struct proc *p;
+  struct runqueue *rq;
 
-  acquire(&ptable.lock);
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if (p->pid == pid)
-      p->tickets = ticket_chance;
+  mask &= (1 << ncpu) - 1;
+  if (mask == 0)
+    return -1;
+  if ((p = findproc(pid)) == 0)
+    return -1;
+  if (p->queue == EDF_QUEUE) {
+    release(&p->lock);
+    return -1;
+  }
+  rq = lock_runqueue(p);
+  if (p->onrq) {
+    dequeue_proc(p);
+    p->affinity = mask;
+    release(&rq->lock);
+    make_runnable(p, p->cpu);
+    kick_cpu(p);
+  } else {
+    p->affinity = mask;
+    release(&rq->lock);
   }
-  release(&ptable.lock); 
+  release(&p->lock);
+
+  if (p == myproc())
+    move_if_disallowed();
+  return 0;
 }
 
-void
-set_a_proc_bjf_params(int pid, int priority_ratio, int arrival_time_ratio, int executed_cycle_ratio)
+// Put a process in the EDF class with runtime ticks of CPU
+// reserved in every period of period ticks, or with a
+// runtime of 0 return it to round robin. Each job is
+// admitted on the least utilized CPU whose EDF utilization
+// stays at most 1 with it, and kept there. Returns -1 if
+// the parameters are invalid or no CPU can take the job.
+int
+set_deadline(int pid, int period, int runtime)
 {
   struct proc *p;
+  struct runqueue *rq;
+  int util, cpu, i, queued;
+
+  if (runtime < 0 || (runtime > 0 && (period <= 0 || runtime > period)))
+    return -1;
+  util = runtime > 0 ? (runtime * EDF_UTIL_SCALE + period - 1) / period : 0;
+  if ((p = findproc(pid)) == 0)
+    return -1;
 
-  acquire(&ptable.lock);
-  for (p = ptable.proc; p < &ptable.proc[NPROC]; p++)
-  {
-    if (p->pid == pid)
-    {
-      p->priority_ratio = priority_ratio;
-      p->arrival_time_ratio = arrival_time_ratio;
-      p->executed_cycle_ratio = executed_cycle_ratio; 
+  cpu = -1;
+  if (runtime > 0) {
+    acquire(&edf_lock);
+    for (i = 0; i < ncpu; i++) {
+      rq = &runqueues[i];
+      if (p->queue == EDF_QUEUE && i == p->edf_cpu)
+        rq->edf_util -= p->edf_util;  // its own share is not in the way
+      if (rq->edf_util + util <= EDF_UTIL_SCALE &&
+          (cpu < 0 || rq->edf_util < runqueues[cpu].edf_util))
+        cpu = i;
+      if (p->queue == EDF_QUEUE && i == p->edf_cpu)
+        rq->edf_util += p->edf_util;
+    }
+    release(&edf_lock);
+    if (cpu < 0) {
+      release(&p->lock);
+      return -1;
     }
   }
-  release(&ptable.lock); 
+
+  rq = lock_runqueue(p);
+  queued = p->onrq;
+  if (queued)
+    dequeue_proc(p);
+  release(&rq->lock);
+
+  if (p->queue == EDF_QUEUE)
+    edf_unreserve(p);
+  if (runtime > 0) {
+    acquire(&edf_lock);
+    runqueues[cpu].edf_util += util;
+    release(&edf_lock);
+    p->queue = EDF_QUEUE;
+    p->edf_period = period;
+    p->edf_runtime = runtime;
+    p->edf_util = util;
+    p->edf_cpu = cpu;
+    p->edf_deadline = ticks + period;
+    p->edf_budget = runtime;
+    p->affinity = 1 << cpu;
+  } else if (p->queue == EDF_QUEUE) {
+    p->queue = RR_QUEUE;
+    p->entered_queue = ticks;
+    p->affinity = (1 << ncpu) - 1;
+    update_rank(p);
+  }
+
+  if (queued) {
+    make_runnable(p, p->cpu);
+    kick_cpu(p);
+  }
+  release(&p->lock);
+
+  if (p == myproc())
+    move_if_disallowed();
+  return 0;
+}
+
+// The CPUs a process may run on, or -1.
+int
+get_affinity(int pid)
+{
+  struct proc *p;
+  int mask;
+
+  if ((p = findproc(pid)) == 0)
+    return -1;
+  mask = p->affinity;
+  release(&p->lock);
+  return mask;
 }
 
 void
 set_all_bjf_params(int priority_ratio, int arrival_time_ratio, int executed_cycle_ratio) {
     struct proc *p;
+    struct runqueue *rq;
 
-    acquire(&ptable.lock);
     for (p = ptable.proc; p < &ptable.proc[NPROC]; p++) {
+        acquire(&p->lock);
+        rq = lock_runqueue(p);
         p->priority_ratio = priority_ratio;
         p->arrival_time_ratio = arrival_time_ratio;
         p->executed_cycle_ratio = executed_cycle_ratio;
+        if (p->state != UNUSED)
+            update_rank(p);
+        release(&rq->lock);
+        release(&p->lock);
     }
-    release(&ptable.lock);
 }
 
 
-void
-printfloat(float num){
-  int beg=(int)(num);
-	int fin=(int)(num*100)-beg*100;
-  cprintf("%d", beg);
-  cprintf(".");
-	if(fin<10)
-    cprintf("0");
-	cprintf("%d", fin);
-}
 int 
 get_lenght(int num)
 {
@@ -855,15 +2449,61 @@ get_lenght(int num)
   }
   return len;
 }
+// Fill in pi from p under p->lock. Returns 0 if the slot
+// is unused.
+static int
+getprocinfo(struct proc *p, struct procinfo *pi)
+{
+  acquire(&p->lock);
+  if(p->state == UNUSED){
+    release(&p->lock);
+    return 0;
+  }
+  pi->pid = p->pid;
+  pi->state = p->state;
+  pi->queue = p->queue;
+  pi->entered_queue = p->entered_queue;
+  pi->tickets = p->tickets;
+  pi->priority_ratio = p->priority_ratio;
+  pi->arrival_time_ratio = p->arrival_time_ratio;
+  pi->executed_cycle_ratio = p->executed_cycle_ratio;
+  pi->rank = p->rank;
+  pi->executed_cycle = p->executed_cycle;
+  pi->last_cpu = p->last_cpu;
+  pi->edf_period = p->edf_period;
+  pi->edf_runtime = p->edf_runtime;
+  pi->edf_misses = p->edf_misses;
+  safestrcpy(pi->name, p->name, sizeof(pi->name));
+  release(&p->lock);
+  return 1;
+}
+
+// Copy a snapshot of up to max processes to buf, for
+// print_procs to format in user space. Returns the number
+// copied.
+int
+getprocs(struct procinfo *buf, int max)
+{
+  struct proc *p;
+  int n;
+
+  n = 0;
+  for(p = ptable.proc; p < &ptable.proc[NPROC] && n < max; p++)
+    n += getprocinfo(p, &buf[n]);
+  return n;
+}
+
+// Prints from a snapshot of each process taken under its
+// lock, so no lock is held while writing to the console.
 void 
 print_all_procs()
 {
-    struct proc *p;
-    cprintf("name       pid       state       queue       arrival_time        tickets     p_ratio      e_ratio       a_ratio       rank       exec_cycle\n");
-    cprintf("...........................................................................................................................................\n");
-    acquire(&ptable.lock);
-    for(p = ptable.proc; p < &ptable.proc[NPROC]; p++){ 
-      if (p->state == UNUSED)
+    struct proc *q;
+    struct procinfo snap, *p = &snap;
+    cprintf("name       pid       state       queue       arrival_time        tickets     p_ratio      e_ratio       a_ratio       rank       exec_cycle    cpu\n");
+    cprintf("........................................................................................................................................................\n");
+    for(q = ptable.proc; q < &ptable.proc[NPROC]; q++){ 
+      if (!getprocinfo(q, &snap))
         continue;
 
 
@@ -890,7 +2530,9 @@ print_all_procs()
     for(int i = 0; i < 12 - strlen(state); i++) cprintf(" ");
 
     char* queue;
-    if (p->queue == 1)
+    if (p->queue == 0)
+      queue="EDF";
+    else if (p->queue == 1)
       queue="RoundRobin";
     else if (p->queue == 2)
       queue="Lottery";
@@ -914,17 +2556,18 @@ print_all_procs()
     cprintf("%d", p->arrival_time_ratio);
     for(int i = 0; i < 14 - get_lenght(p->arrival_time_ratio); i++) cprintf(" ");      
 
-    printfloat(get_rank(p));
-    for(int i = 0; i < 11 - get_lenght((int)get_rank(p))-2; i++) cprintf(" ");  
+    cprintf("%d.%d0", p->rank / RANK_SCALE, p->rank % RANK_SCALE);
+    for(int i = 0; i < 11 - get_lenght(p->rank / RANK_SCALE)-2; i++) cprintf(" ");  
+
+    cprintf("%d", p->executed_cycle);
+    for(int i = 0; i < 14 - get_lenght(p->executed_cycle); i++) cprintf(" ");
 
-    float executed_cycle = p->executed_cycle*10;
-    if(executed_cycle - (int)(executed_cycle) <= 0.5)
-      cprintf("%d", (int)(executed_cycle));
+    if (p->last_cpu >= 0)
+      cprintf("%d", p->last_cpu);
     else
-      cprintf("%d", (int)(executed_cycle)+1);
+      cprintf("-");
 
     cprintf("\n");
   }
-  release(&ptable.lock);
   
 }
\ No newline at end of file
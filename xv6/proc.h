@@ -1,5 +1,7 @@
 // Per-CPU state
 struct cpu {
+  struct cpu *self;            // This struct; %gs:0 (see mycpu)
+  struct proc *proc;           // The process running on this cpu or null; %gs:4
   uchar apicid;                // Local APIC ID
   struct context *scheduler;   // swtch() here to enter scheduler
   struct taskstate ts;         // Used by x86 to find stack for interrupt
@@ -7,7 +9,16 @@ struct cpu {
   volatile uint started;       // Has the CPU started?
   int ncli;                    // Depth of pushcli nesting.
   int intena;                  // Were interrupts enabled before pushcli?
-  struct proc *proc;           // The process running on this cpu or null
+  uint rand;                   // xorshift state for lottery draws
+  volatile int idle;           // Halted in scheduler() waiting for work?
+  volatile uint ipi_pending;   // Claimed by the kicker that sends us an IPI
+  volatile uint64 ipi_tsc;     // When that IPI was sent, or 0
+  uint halts;                  // Idle and wake-up accounting (see cpustat)
+  uint ipis_sent;
+  uint ipis_received;
+  uint64 idle_cycles;
+  uint64 wake_cycles;
+  uint64 max_wake_cycles;
 };
 
 extern struct cpu cpus[NCPU];
@@ -34,29 +45,98 @@ struct context {
 
 enum procstate { UNUSED, EMBRYO, SLEEPING, RUNNABLE, RUNNING, ZOMBIE };
 
+// Scheduling levels (p->queue), highest priority first.
+// EDF is a class of its own above the three levels.
+#define EDF_QUEUE      0
+#define RR_QUEUE       1
+#define LOTTERY_QUEUE  2
+#define BJF_QUEUE      3
+#define NQUEUE         3
+
 // Per-process state
 struct proc {
+  struct spinlock lock;
+
+  // p->lock must be held when using these:
+  enum procstate state;        // Process state
+  void *chan;                  // If non-zero, sleeping on chan
+  int killed;                  // If non-zero, have been killed
+  int pid;                     // Process ID
+
+  // wait_lock must be held when using these:
+  struct proc *parent;         // Parent process, or leader of a thread
+  struct proc *children;       // Live children
+  struct proc *zombies;        // Exited children not yet waited for
+  struct proc *sibling_next;   // Links on parent's children or zombies list
+  struct proc *sibling_prev;
+  int nthreads;                // Leader: threads not yet joined
+  struct proc *thread_zombies; // Leader: exited threads not yet joined
+
+  // Threads made by clone() share the pgdir of their leader,
+  // and use the leader's sz and ofile, guarded by its tlock.
+  struct proc *leader;         // Thread group leader, or this process
+  struct spinlock tlock;
+  char *ustack;                // Thread: user stack, handed back by join
+  struct pkinfo *pkinfo;       // Leader: page mapped at PKINFO (kinfo.h)
+
+  // these are private to the process, so p->lock need not be held.
   uint sz;                     // Size of process memory (bytes)
   pde_t* pgdir;                // Page table
   char *kstack;                // Bottom of kernel stack for this process
-  enum procstate state;        // Process state
-  int pid;                     // Process ID
-  struct proc *parent;         // Parent process
   struct trapframe *tf;        // Trap frame for current syscall
   struct context *context;     // swtch() here to run process
-  void *chan;                  // If non-zero, sleeping on chan
-  int killed;                  // If non-zero, have been killed
   struct file *ofile[NOFILE];  // Open files
   struct inode *cwd;           // Current directory
   char name[16];               // Process name (debugging)
+
+  // Scheduling state. Protected by p->lock, and while the
+  // process is on a run queue also by that queue's lock.
   int queue;                   // queue number
   int entered_queue;           // time entered queue
   int tickets;                 // number of lottery tickets
   int priority_ratio;         
   int arrival_time_ratio;
   int executed_cycle_ratio;
-  float executed_cycle;
+  int executed_cycle;          // cycles executed, in tenths
   int priority;
+  int rank;                    // cached BJF rank, in tenths
+  int heap_index;              // position in run queue's BJF heap
+  uint age_deadline;           // tick at which a waiting process is promoted
+  struct proc *age_next;       // Links on run queue's aging wheel slot
+  struct proc *age_prev;
+  uint affinity;               // CPUs it may run on, one bit per cpu index
+  int last_cpu;                // CPU it last ran on, or -1
+  int slice_used;              // ticks of its current time slice used
+  int pi_queue;                // level to go back to when boosted, or 0
+  int pi_nsem;                 // semaphores it is boosted for
+  int pi_sem[NPIBOOST];        // and for each, the highest waiter's level
+  int pi_level[NPIBOOST];
+
+  // EDF class (queue EDF_QUEUE), in ticks.
+  int edf_period;
+  int edf_runtime;             // CPU time reserved per period
+  uint edf_deadline;           // of the current job
+  int edf_budget;              // runtime left in the current job
+  int edf_util;                // share of edf_cpu reserved, per EDF_UTIL_SCALE
+  int edf_cpu;                 // CPU the job was admitted on
+  uint edf_misses;             // deadlines passed with budget left
+
+  // Latency accounting (see procstat). Protected by p->lock.
+  uint64 stat_tsc;             // when it last started running or waiting
+  int woken;                   // made runnable by a wakeup?
+  uint64 run_cycles;
+  uint64 wait_cycles;
+  uint nvcsw;
+  uint nivcsw;
+  uint wakeup_lat[NLATBUCKET];
+  int cpu;                     // Run queue this process belongs to
+  int onrq;                    // Currently queued on it?
+  struct proc *rq_next;        // Links on that run queue's level list
+  struct proc *rq_prev;
+
+  struct proc *sleep_next;     // Links on the wait-channel hash bucket
+  struct proc *sleep_prev;     // (protected by the bucket's lock)
+  struct proc *pid_next;       // Next on the pid hash chain (pid_lock)
 };
 
 // Process memory is laid out contiguously, low addresses first:
@@ -65,7 +145,3 @@ struct proc {
 //   fixed-size stack
 //   expandable heap
 
-#define NUM_OF_SYSCALLS 50
-#define MAX_PID_NUM_SAVED 1000
-#define MAX_PID_TRACED 1000
-#define MAX_PID_OUTPUT_IN_ONE_LINE 11
@@ -0,0 +1,47 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+
+static char *levels[] = { "EDF", "RoundRobin", "Lottery", "BJF" };
+
+// print per-process run and wait time and context switches,
+// then the wakeup-to-run latency histogram of each level
+int
+main(int argc, char *argv[])
+{
+  struct procstat *st;
+  uint lat[4][NLATBUCKET];
+  int i, b, n, q;
+
+  if((st = malloc(NPROC * sizeof(*st))) == 0){
+    printf(2, "procstat: out of memory\n");
+    exit();
+  }
+  n = procstat(st, NPROC);
+  if(n < 0){
+    printf(2, "procstat: failed\n");
+    exit();
+  }
+
+  memset(lat, 0, sizeof(lat));
+  printf(1, "pid  name        queue       run_cycles          wait_cycles         vol      invol\n");
+  for(i = 0; i < n; i++){
+    q = st[i].queue >= 0 && st[i].queue <= 3 ? st[i].queue : 1;
+    printf(1, "%d    %s        %s        %l        %l        %d        %d\n",
+           st[i].pid, st[i].name, levels[q], st[i].run_cycles,
+           st[i].wait_cycles, st[i].nvcsw, st[i].nivcsw);
+    for(b = 0; b < NLATBUCKET; b++)
+      lat[q][b] += st[i].wakeup_lat[b];
+  }
+
+  for(q = 0; q <= 3; q++){
+    printf(1, "\n%s wakeup-to-run latency (cycles):\n", levels[q]);
+    for(b = 0; b < NLATBUCKET; b++)
+      if(lat[q][b])
+        printf(1, "  >= 2^%d: %d\n", b, lat[q][b]);
+  }
+  free(st);
+  exit();
+}
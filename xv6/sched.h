@@ -0,0 +1,77 @@
+// One entry of a set_sched_params() batch. Fields left at
+// -1 are not changed.
+struct sched_param {
+  int pid;
+  int queue;                 // 0 EDF, 1 round robin, 2 lottery, 3 BJF
+  int tickets;
+  int priority_ratio;
+  int arrival_time_ratio;
+  int executed_cycle_ratio;
+  int result;                // out: 0 if applied, -1 if not
+};
+
+// Per-CPU scheduler counters, filled in by cpustat().
+// Times are in TSC cycles.
+struct cpustat {
+  uint halts;              // times the CPU halted for lack of work
+  uint ipis_sent;          // reschedule IPIs sent to other CPUs
+  uint ipis_received;      // halts ended by a reschedule IPI
+  uint64 idle_cycles;      // time spent halted
+  uint64 wake_cycles;      // total IPI-to-resume latency
+  uint64 max_wake_cycles;  // worst IPI-to-resume latency
+  uint promotions;         // starving processes promoted to round robin
+  uint boosts;             // semaphore holders run at a waiter's level
+};
+
+// Latency of one syscall, filled in by sysstat(). Summed
+// over the CPUs; times are in TSC cycles.
+struct sysstat {
+  int num;                  // syscall number
+  uint count;
+  uint64 cycles;            // total time from dispatch to return
+  uint lat[NLATBUCKET];     // bucket i counts latencies in [2^i, 2^(i+1))
+};
+
+// Spinlock counters for all locks of one name, filled in
+// by lockstat(). Times are in TSC cycles.
+struct lockstat {
+  char name[16];
+  uint nacquire;
+  uint ncontended;         // acquires that had to wait
+  uint64 spin_cycles;      // total time spent waiting
+  uint64 max_hold_cycles;  // longest time one was held
+};
+
+// Per-process scheduler counters, filled in by procstat().
+// Times are in TSC cycles. Needs param.h.
+struct procstat {
+  int pid;
+  int queue;                // level it is on now
+  char name[16];
+  uint64 run_cycles;        // time spent RUNNING
+  uint64 wait_cycles;       // time spent RUNNABLE, waiting for a CPU
+  uint nvcsw;               // voluntary switches (went to sleep)
+  uint nivcsw;              // involuntary switches (preempted)
+  uint wakeup_lat[NLATBUCKET]; // wakeup-to-run latency, bucket i
+                               // counting latencies in [2^i, 2^(i+1))
+};
+
+// Snapshot of one process, filled in by getprocs().
+struct procinfo {
+  int pid;
+  int state;                 // enum procstate: 1 embryo, 2 sleeping,
+                             // 3 runnable, 4 running, 5 zombie
+  int queue;                 // 0 EDF, 1 round robin, 2 lottery, 3 BJF
+  int entered_queue;         // tick it last entered its queue
+  int tickets;
+  int priority_ratio;
+  int arrival_time_ratio;
+  int executed_cycle_ratio;
+  int rank;                  // BJF rank, in tenths
+  int executed_cycle;        // in tenths
+  int last_cpu;              // or -1 if it has not run yet
+  int edf_period;            // EDF reservation, in ticks
+  int edf_runtime;
+  uint edf_misses;
+  char name[16];
+};
@@ -0,0 +1,69 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+
+#define NWORKER 4
+#define ITERS 20000
+#define OPS_PER_ITER 4
+
+// usage: schedbench [nworkers [iterations]]
+// Each worker loops over paths that used to serialize on a
+// single process table lock: a wakeup on each side of a
+// pipe round trip, and two scheduler tuning calls on its
+// own pid. Prints operations per tick, so runs under
+// different CPUS= can be compared.
+static void
+worker(int iters)
+{
+  int fds[2], i, pid;
+  char c;
+
+  if(pipe(fds) < 0){
+    printf(2, "schedbench: pipe failed\n");
+    exit();
+  }
+  pid = getpid();
+  c = 0;
+  for(i = 0; i < iters; i++){
+    write(fds[1], &c, 1);
+    read(fds[0], &c, 1);
+    set_lottery_params(pid, i % 30 + 1);
+    set_a_proc_bjf_params(pid, 1, 1, 1);
+  }
+  exit();
+}
+
+int
+main(int argc, char *argv[])
+{
+  int nworker, iters, i, start, elapsed, ops;
+
+  nworker = argc > 1 ? atoi(argv[1]) : NWORKER;
+  iters = argc > 2 ? atoi(argv[2]) : ITERS;
+  if(nworker <= 0 || iters <= 0){
+    printf(2, "usage: schedbench [nworkers [iterations]]\n");
+    exit();
+  }
+
+  start = uptime();
+  for(i = 0; i < nworker; i++){
+    int pid = fork();
+    if(pid < 0){
+      printf(2, "schedbench: fork failed\n");
+      break;
+    }
+    if(pid == 0)
+      worker(iters);
+  }
+  nworker = i;
+  for(i = 0; i < nworker; i++)
+    wait();
+  elapsed = uptime() - start;
+
+  ops = nworker * iters * OPS_PER_ITER;
+  printf(1, "%d workers, %d ops in %d ticks", nworker, ops, elapsed);
+  if(elapsed > 0)
+    printf(1, ", %d ops/tick", ops / elapsed);
+  printf(1, "\n");
+  exit();
+}
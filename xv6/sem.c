@@ -0,0 +1,381 @@
+// Counting semaphores, opened by name or used by handle.
+//
+// Semaphores are allocated a page at a time, up to NSEM,
+// and each has its own lock. Waiters queue in arrival
+// order, and a release hands its permit straight to the
+// oldest waiter, so a process that comes along later
+// cannot take it first. The process that last took a
+// permit is its owner, and runs at least at the level of
+// any waiter (see pi_boost).
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+
+// A waiting process, on its own kernel stack. It sleeps on
+// its own semwaiter, so a release wakes only the waiter it
+// hands the permit to.
+struct semwaiter {
+  int pid;
+  int queue;                // its scheduling level
+  int granted;              // handed a permit by sem_release
+  struct semwaiter *next;
+  uint deadline;            // timed waiters: tick its time is up
+  struct semwaiter *tnext;  // on semtimers, soonest first
+};
+
+struct semaphore {
+  struct spinlock lock;
+  int value;                // permits nobody is waiting for
+  struct semwaiter *head;   // waiters, oldest first
+  struct semwaiter *tail;
+  int owner;                // pid that last took a permit, or 0
+
+  // semtable.lock and lock must both be held to change
+  // these, so either is enough to read them.
+  int used;
+  int refs;                 // sem_open()s not yet closed
+  char name[SEMNAME];       // or "" if opened by handle
+};
+
+#define SEMPERPAGE (PGSIZE / sizeof(struct semaphore))
+
+struct {
+  struct spinlock lock;
+  struct semaphore *page[(NSEM + SEMPERPAGE - 1) / SEMPERPAGE];
+  int nsem;                 // handles below this have a slot
+} semtable;
+
+// Timed waiters, for sem_tick to wake when their time is
+// up. Taken after a semaphore's lock.
+struct {
+  struct spinlock lock;
+  struct semwaiter *head;
+} semtimers;
+
+void
+seminit(void)
+{
+  initlock(&semtable.lock, "semtable");
+  initlock(&semtimers.lock, "semtimers");
+}
+
+static void
+timer_insert(struct semwaiter *w)
+{
+  struct semwaiter **pp;
+
+  acquire(&semtimers.lock);
+  for(pp = &semtimers.head; *pp && (int)((*pp)->deadline - w->deadline) <= 0; pp = &(*pp)->tnext)
+    ;
+  w->tnext = *pp;
+  *pp = w;
+  release(&semtimers.lock);
+}
+
+static void
+timer_remove(struct semwaiter *w)
+{
+  struct semwaiter **pp;
+
+  acquire(&semtimers.lock);
+  for(pp = &semtimers.head; *pp != w; pp = &(*pp)->tnext)
+    ;
+  *pp = w->tnext;
+  release(&semtimers.lock);
+}
+
+// Called by the timer interrupt on CPU 0 after ticks changes.
+// Wakes every timed waiter whose time is up; each stays on
+// the list until it has seen so itself, so a wakeup that
+// comes before it is asleep is repeated on the next tick.
+void
+sem_tick(void)
+{
+  struct semwaiter *w;
+
+  acquire(&semtimers.lock);
+  for(w = semtimers.head; w && (int)(ticks - w->deadline) >= 0; w = w->tnext)
+    wakeup(w);
+  release(&semtimers.lock);
+}
+
+// Make room for handles up to h. Caller must hold
+// semtable.lock.
+static int
+semgrow(int h)
+{
+  struct semaphore *s;
+  int i;
+
+  while(semtable.nsem <= h){
+    if(semtable.nsem >= NSEM || (s = (struct semaphore*)kalloc()) == 0)
+      return -1;
+    memset(s, 0, PGSIZE);
+    for(i = 0; i < SEMPERPAGE; i++)
+      initlock(&s[i].lock, "sem");
+    semtable.page[semtable.nsem / SEMPERPAGE] = s;
+    // semget reads nsem without the lock.
+    __sync_synchronize();
+    semtable.nsem += SEMPERPAGE;
+  }
+  return 0;
+}
+
+static struct semaphore*
+semget(int h)
+{
+  if(h < 0 || h >= semtable.nsem)
+    return 0;
+  return &semtable.page[h / SEMPERPAGE][h % SEMPERPAGE];
+}
+
+// Set up handle h with value permits. Returns the handle.
+// Caller must hold semtable.lock and s->lock.
+static int
+semset(struct semaphore *s, int h, char *name, int value)
+{
+  s->used = 1;
+  s->refs = name != 0;
+  safestrcpy(s->name, name ? name : "", sizeof(s->name));
+  s->value = value;
+  s->owner = 0;
+  return h;
+}
+
+// Open the semaphore called name, creating it with value
+// permits if there is none. Returns its handle, or -1.
+int
+sem_open(char *name, int value)
+{
+  struct semaphore *s;
+  int h, free;
+
+  if(*name == 0 || value < 0)
+    return -1;
+  acquire(&semtable.lock);
+  free = -1;
+  for(h = 0; h < semtable.nsem; h++){
+    s = semget(h);
+    if(s->used && strncmp(s->name, name, SEMNAME) == 0){
+      s->refs++;
+      release(&semtable.lock);
+      return h;
+    }
+    if(!s->used && free < 0)
+      free = h;
+  }
+  if(free < 0){
+    free = semtable.nsem;
+    if(semgrow(free) < 0){
+      release(&semtable.lock);
+      return -1;
+    }
+  }
+  s = semget(free);
+  acquire(&s->lock);
+  h = semset(s, free, name, value);
+  release(&s->lock);
+  release(&semtable.lock);
+  return h;
+}
+
+// Drop a reference from sem_open. The semaphore goes away
+// once nothing has it open and nothing waits on it.
+int
+sem_close(int h)
+{
+  struct semaphore *s;
+
+  acquire(&semtable.lock);
+  if((s = semget(h)) == 0 || !s->used){
+    release(&semtable.lock);
+    return -1;
+  }
+  acquire(&s->lock);
+  if(s->refs > 0)
+    s->refs--;
+  if(s->refs == 0 && s->head == 0)
+    s->used = 0;
+  release(&s->lock);
+  release(&semtable.lock);
+  return 0;
+}
+
+// Give handle h value permits, as an unnamed semaphore if
+// it is not in use. Fails if anyone is waiting on it.
+int
+sem_init(int h, int value)
+{
+  struct semaphore *s;
+  int r;
+
+  if(h < 0 || h >= NSEM || value < 0)
+    return -1;
+  acquire(&semtable.lock);
+  if(semgrow(h) < 0){
+    release(&semtable.lock);
+    return -1;
+  }
+  s = semget(h);
+  acquire(&s->lock);
+  r = -1;
+  if(s->head == 0){
+    if(s->used){
+      s->value = value;
+      s->owner = 0;
+    }
+    else
+      semset(s, h, 0, value);
+    r = 0;
+  }
+  release(&s->lock);
+  release(&semtable.lock);
+  return r;
+}
+
+// A named semaphore whose last reference was closed while
+// processes waited on it goes away once the last of them
+// leaves. Called by a waiter after it let go of s->lock.
+static void
+semidle(struct semaphore *s)
+{
+  acquire(&semtable.lock);
+  acquire(&s->lock);
+  if(s->used && s->name[0] && s->refs == 0 && s->head == 0)
+    s->used = 0;
+  release(&s->lock);
+  release(&semtable.lock);
+}
+
+// Take a permit from h, waiting at most timeout ticks for
+// one, or forever if timeout is negative. Returns 0, or -1
+// if h is bad, time ran out or the caller was killed.
+static int
+semwait(int h, int timeout)
+{
+  struct semaphore *s;
+  struct semwaiter w, *prev;
+  int r, closed;
+
+  if((s = semget(h)) == 0)
+    return -1;
+  acquire(&s->lock);
+  if(!s->used){
+    release(&s->lock);
+    return -1;
+  }
+  if(s->value > 0){
+    s->value--;
+    s->owner = myproc()->pid;
+    release(&s->lock);
+    return 0;
+  }
+  if(timeout == 0){
+    release(&s->lock);
+    return -1;
+  }
+
+  w.pid = myproc()->pid;
+  w.queue = myproc()->queue;
+  w.granted = 0;
+  w.next = 0;
+  if(s->tail)
+    s->tail->next = &w;
+  else
+    s->head = &w;
+  s->tail = &w;
+  if(s->owner)
+    pi_boost(s->owner, w.queue, h);
+  if(timeout > 0){
+    w.deadline = ticks + timeout;
+    timer_insert(&w);
+  }
+
+  r = 0;
+  while(!w.granted){
+    if(myproc()->killed || (timeout > 0 && (int)(ticks - w.deadline) >= 0)){
+      prev = 0;
+      if(s->head != &w)
+        for(prev = s->head; prev->next != &w; prev = prev->next)
+          ;
+      if(prev)
+        prev->next = w.next;
+      else
+        s->head = w.next;
+      if(s->tail == &w)
+        s->tail = prev;
+      r = -1;
+      break;
+    }
+    sleep(&w, &s->lock);
+  }
+  if(timeout > 0)
+    timer_remove(&w);
+  closed = s->name[0] && s->refs == 0 && s->head == 0;
+  release(&s->lock);
+  if(closed)
+    semidle(s);
+  return r;
+}
+
+int
+sem_acquire(int h)
+{
+  return semwait(h, -1);
+}
+
+int
+sem_tryacquire(int h)
+{
+  return semwait(h, 0);
+}
+
+int
+sem_timedacquire(int h, int timeout)
+{
+  if(timeout < 0)
+    return -1;
+  return semwait(h, timeout);
+}
+
+// Return a permit to h, handing it to the oldest waiter if
+// there is one. The new owner inherits the highest level
+// still waiting.
+int
+sem_release(int h)
+{
+  struct semaphore *s;
+  struct semwaiter *w, *x;
+  int queue;
+
+  if((s = semget(h)) == 0)
+    return -1;
+  acquire(&s->lock);
+  if(!s->used){
+    release(&s->lock);
+    return -1;
+  }
+  if(s->owner == myproc()->pid)
+    s->owner = 0;
+  pi_restore(h);
+  if((w = s->head) != 0){
+    if((s->head = w->next) == 0)
+      s->tail = 0;
+    w->granted = 1;
+    s->owner = w->pid;
+    queue = NQUEUE + 1;
+    for(x = s->head; x; x = x->next)
+      if(x->queue < queue)
+        queue = x->queue;
+    if(queue <= NQUEUE)
+      pi_boost(w->pid, queue, h);
+    wakeup(w);
+  } else
+    s->value++;
+  release(&s->lock);
+  return 0;
+}
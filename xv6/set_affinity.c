@@ -0,0 +1,19 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+// usage: set_affinity pid mask
+// mask has bit i set for each CPU i the process may run on.
+int
+main(int argc, char *argv[])
+{
+  if(argc != 3){
+    printf(2, "usage: set_affinity pid mask\n");
+    exit();
+  }
+  if(set_affinity(atoi(argv[1]), atoi(argv[2])) < 0)
+    printf(2, "set_affinity: cannot set pid %s to mask %s\n", argv[1], argv[2]);
+
+  exit();
+}
@@ -0,0 +1,21 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+// usage: set_deadline pid period runtime
+// Reserve runtime ticks of every period ticks for pid under
+// EDF; a runtime of 0 moves it back to round robin.
+int
+main(int argc, char *argv[])
+{
+  if(argc != 4){
+    printf(2, "usage: set_deadline pid period runtime\n");
+    exit();
+  }
+  if(set_deadline(atoi(argv[1]), atoi(argv[2]), atoi(argv[3])) < 0)
+    printf(2, "set_deadline: cannot admit pid %s with period %s runtime %s\n",
+           argv[1], argv[2], argv[3]);
+
+  exit();
+}
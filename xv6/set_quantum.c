@@ -0,0 +1,26 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+// usage: set_quantum queue ticks [demote]
+// queue is 1 (round robin), 2 (lottery) or 3 (BJF); demote
+// is 1 if using up a whole slice moves a process down a
+// level. Give -1 to leave ticks or demote unchanged.
+int
+main(int argc, char *argv[])
+{
+  int ticks, demote;
+
+  if(argc != 3 && argc != 4){
+    printf(2, "usage: set_quantum queue ticks [demote]\n");
+    exit();
+  }
+  // atoi() only understands digits, so spell out -1.
+  ticks = argv[2][0] == '-' ? -1 : atoi(argv[2]);
+  demote = argc < 4 || argv[3][0] == '-' ? -1 : atoi(argv[3]);
+  if(set_quantum(atoi(argv[1]), ticks, demote) < 0)
+    printf(2, "set_quantum: invalid queue %s or ticks %s\n", argv[1], argv[2]);
+
+  exit();
+}
@@ -0,0 +1,45 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+#include "param.h"
+#include "sched.h"
+
+#define NFIELD 6
+#define MAXBATCH 16
+
+// usage: set_sched_params pid queue tickets p_ratio a_ratio e_ratio [pid ...]
+// applies every group of six numbers in one system call;
+// -1 leaves a field unchanged.
+int
+main(int argc, char *argv[])
+{
+  struct sched_param sp[MAXBATCH];
+  int i, n;
+
+  if(argc < 1 + NFIELD || (argc - 1) % NFIELD != 0){
+    printf(2, "usage: set_sched_params pid queue tickets p_ratio a_ratio e_ratio ...\n");
+    exit();
+  }
+
+  n = (argc - 1) / NFIELD;
+  if(n > MAXBATCH)
+    n = MAXBATCH;
+  for(i = 0; i < n; i++){
+    char **f = &argv[1 + i*NFIELD];
+    // atoi() only understands digits, so spell out -1.
+    sp[i].pid = atoi(f[0]);
+    sp[i].queue = f[1][0] == '-' ? -1 : atoi(f[1]);
+    sp[i].tickets = f[2][0] == '-' ? -1 : atoi(f[2]);
+    sp[i].priority_ratio = f[3][0] == '-' ? -1 : atoi(f[3]);
+    sp[i].arrival_time_ratio = f[4][0] == '-' ? -1 : atoi(f[4]);
+    sp[i].executed_cycle_ratio = f[5][0] == '-' ? -1 : atoi(f[5]);
+  }
+
+  set_sched_params(sp, n);
+  for(i = 0; i < n; i++)
+    if(sp[i].result < 0)
+      printf(2, "set_sched_params: pid %d not updated\n", sp[i].pid);
+
+  exit();
+}
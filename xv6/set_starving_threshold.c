@@ -0,0 +1,15 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "fcntl.h"
+
+
+
+int
+main(int argc, char *argv[])
+{  
+  if(set_starving_threshold(atoi(argv[1])) < 0)
+    printf(2, "set_starving_threshold: invalid threshold %s\n", argv[1]);
+
+  exit();
+}
@@ -6,15 +6,70 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
-#include "proc.h"
 #include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+
+// Lock statistics are kept per lock name, so all "proc"
+// locks share one set, and per CPU, so each counter is only
+// changed by the CPU holding a lock of that name.
+struct lockcount {
+  uint nacquire;
+  uint ncontended;
+  uint64 spin_cycles;
+  uint64 max_hold_cycles;
+};
+
+struct lockclass {
+  char *name;
+  struct lockcount count[NCPU];
+};
+
+static struct lockclass lockclass[NLOCKSTAT];
+static int nlockclass;
+static uint classlock;  // guards adding a class
+
+// The class for locks called name, or 0 if the table is
+// full. initlock runs before mycpu() works, so this spins
+// on a bare word with interrupts off instead of using a
+// spinlock.
+static struct lockclass*
+lockclass_get(char *name)
+{
+  struct lockclass *c;
+  uint eflags;
+  int i;
+
+  eflags = readeflags();
+  cli();
+  while(xchg(&classlock, 1) != 0)
+    pause();
+  c = 0;
+  for(i = 0; i < nlockclass; i++)
+    if(strncmp(lockclass[i].name, name, sizeof(((struct lockstat*)0)->name)) == 0){
+      c = &lockclass[i];
+      break;
+    }
+  if(c == 0 && nlockclass < NLOCKSTAT){
+    c = &lockclass[nlockclass];
+    c->name = name;
+    __sync_synchronize();
+    nlockclass++;
+  }
+  xchg(&classlock, 0);
+  if(eflags & FL_IF)
+    sti();
+  return c;
+}
 
 void
 initlock(struct spinlock *lk, char *name)
 {
   lk->name = name;
-  lk->locked = 0;
+  lk->next = 0;
+  lk->owner = 0;
   lk->cpu = 0;
+  lk->class = lockclass_get(name);
 }
 
 // Acquire the lock.
@@ -24,13 +79,23 @@ initlock(struct spinlock *lk, char *name)
 void
 acquire(struct spinlock *lk)
 {
+  struct lockcount *c;
+  uint ticket;
+  uint64 start;
+
   pushcli(); // disable interrupts to avoid deadlock.
   if(holding(lk))
     panic("acquire");
 
-  // The xchg is atomic.
-  while(xchg(&lk->locked, 1) != 0)
-    ;
+  // The xadd is atomic. Spinning only reads owner, so the
+  // line stays shared until the holder lets go.
+  ticket = xadd(&lk->next, 1);
+  start = 0;
+  if(lk->owner != ticket){
+    start = rdtsc();
+    while(lk->owner != ticket)
+      pause();
+  }
 
   // Tell the C compiler and the processor to not move loads or stores
   // past this point, to ensure that the critical section's memory
@@ -39,17 +104,41 @@ acquire(struct spinlock *lk)
 
   // Record info about lock acquisition for debugging.
   lk->cpu = mycpu();
+#ifdef LOCKDEBUG
   getcallerpcs(&lk, lk->pcs);
+#endif
+
+  lk->held_at = rdtsc();
+  if(lk->class){
+    c = &lk->class->count[lk->cpu - cpus];
+    c->nacquire++;
+    if(start){
+      c->ncontended++;
+      c->spin_cycles += lk->held_at - start;
+    }
+  }
 }
 
 // Release the lock.
 void
 release(struct spinlock *lk)
 {
+  struct lockcount *c;
+  uint64 held;
+
   if(!holding(lk))
     panic("release");
 
+  if(lk->class){
+    c = &lk->class->count[lk->cpu - cpus];
+    held = rdtsc() - lk->held_at;
+    if(held > c->max_hold_cycles)
+      c->max_hold_cycles = held;
+  }
+
+#ifdef LOCKDEBUG
   lk->pcs[0] = 0;
+#endif
   lk->cpu = 0;
 
   // Tell the C compiler and the processor to not move loads or stores
@@ -59,10 +148,10 @@ release(struct spinlock *lk)
   // stores; __sync_synchronize() tells them both not to.
   __sync_synchronize();
 
-  // Release the lock, equivalent to lk->locked = 0.
-  // This code can't use a C assignment, since it might
-  // not be atomic. A real OS would use C atomics here.
-  asm volatile("movl $0, %0" : "+m" (lk->locked) : );
+  // Serve the next ticket, equivalent to lk->owner++. Only
+  // the holder writes owner, so this need not be locked.
+  // A real OS would use C atomics here.
+  asm volatile("incl %0" : "+m" (lk->owner) : );
 
   popcli();
 }
@@ -91,7 +180,7 @@ holding(struct spinlock *lock)
 {
   int r;
   pushcli();
-  r = lock->locked && lock->cpu == mycpu();
+  r = lock->owner != lock->next && lock->cpu == mycpu();
   popcli();
   return r;
 }
@@ -124,3 +213,51 @@ popcli(void)
     sti();
 }
 
+// Time n acquire/release pairs of an uncontended lock, for
+// the lockbench program. Returns the average in TSC cycles.
+int
+lockbench(int n)
+{
+  struct spinlock lk;
+  uint64 t0, t1;
+  int i;
+
+  if(n <= 0 || n > 1000000)  // keep the total within 32 bits
+    return -1;
+  initlock(&lk, "lockbench");
+  t0 = rdtsc();
+  for(i = 0; i < n; i++){
+    acquire(&lk);
+    release(&lk);
+  }
+  t1 = rdtsc();
+  return (uint)(t1 - t0) / n;
+}
+
+// Copy the counters of up to n lock names to st, summed
+// over the CPUs, and zero them if reset is set. Returns the
+// number copied.
+int
+lockstat(struct lockstat *st, int n, int reset)
+{
+  struct lockclass *lc;
+  struct lockcount *c;
+  int i;
+
+  for(i = 0; i < nlockclass && i < n; i++, st++){
+    lc = &lockclass[i];
+    safestrcpy(st->name, lc->name, sizeof(st->name));
+    st->nacquire = st->ncontended = 0;
+    st->spin_cycles = st->max_hold_cycles = 0;
+    for(c = lc->count; c < &lc->count[NCPU]; c++){
+      st->nacquire += c->nacquire;
+      st->ncontended += c->ncontended;
+      st->spin_cycles += c->spin_cycles;
+      if(c->max_hold_cycles > st->max_hold_cycles)
+        st->max_hold_cycles = c->max_hold_cycles;
+    }
+    if(reset)
+      memset(lc->count, 0, sizeof(lc->count));
+  }
+  return i;
+}
@@ -1,11 +1,19 @@
-// Mutual exclusion lock.
+// Mutual exclusion lock. A ticket lock: each CPU takes the
+// next ticket and waits until owner reaches it, so waiters
+// get the lock in the order they asked for it.
 struct spinlock {
-  uint locked;       // Is the lock held?
+  volatile uint next;   // Next ticket to hand out
+  volatile uint owner;  // Ticket that holds the lock; held if != next
 
   // For debugging:
   char *name;        // Name of lock.
   struct cpu *cpu;   // The cpu holding the lock.
+#ifdef LOCKDEBUG
   uint pcs[10];      // The call stack (an array of program counters)
                      // that locked the lock.
-};
+#endif
 
+  // For lockstat:
+  struct lockclass *class;  // Counters for locks of this name
+  uint64 held_at;           // When the holder acquired it
+};
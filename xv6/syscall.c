@@ -3,15 +3,15 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "syscall.h"
 
-// User code makes a system call with INT T_SYSCALL.
-// System call number in %eax.
-// Arguments on the stack, from the user call to the C
-// library system call function. The saved user %esp points
-// to a saved program counter, and then the first argument.
+// User code makes a system call with SYSENTER (see usys.S),
+// or with INT T_SYSCALL. System call number in %eax.
+// Up to five arguments in %ebx, %ecx, %edx, %esi and %edi,
+// as saved in the trap frame.
 
 // Fetch the int at addr from the current process.
 int
@@ -19,7 +19,7 @@ fetchint(uint addr, int *ip)
 {
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz || addr+4 > curproc->sz)
+  if(addr >= curproc->leader->sz || addr+4 > curproc->leader->sz)
     return -1;
   *ip = *(int*)(addr);
   return 0;
@@ -34,10 +34,10 @@ fetchstr(uint addr, char **pp)
   char *s, *ep;
   struct proc *curproc = myproc();
 
-  if(addr >= curproc->sz)
+  if(addr >= curproc->leader->sz)
     return -1;
   *pp = (char*)addr;
-  ep = (char*)curproc->sz;
+  ep = (char*)curproc->leader->sz;
   for(s = *pp; s < ep; s++){
     if(*s == 0)
       return s - *pp;
@@ -49,7 +49,18 @@ fetchstr(uint addr, char **pp)
 int
 argint(int n, int *ip)
 {
-  return fetchint((myproc()->tf->esp) + 4 + 4*n, ip);
+  struct trapframe *tf = myproc()->tf;
+
+  switch(n){
+  case 0: *ip = tf->ebx; break;
+  case 1: *ip = tf->ecx; break;
+  case 2: *ip = tf->edx; break;
+  case 3: *ip = tf->esi; break;
+  case 4: *ip = tf->edi; break;
+  default:
+    return -1;
+  }
+  return 0;
 }
 
 // Fetch the nth word-sized system call argument as a pointer
@@ -63,7 +74,7 @@ argptr(int n, char **pp, int size)
  
   if(argint(n, &i) < 0)
     return -1;
-  if(size < 0 || (uint)i >= curproc->sz || (uint)i+size > curproc->sz)
+  if(size < 0 || (uint)i >= curproc->leader->sz || (uint)i+size > curproc->leader->sz)
     return -1;
   *pp = (char*)i;
   return 0;
@@ -115,6 +126,30 @@ extern int sys_print_all_procs(void);
 extern int sys_sem_init(void);
 extern int sys_sem_acquire(void);
 extern int sys_sem_release(void);
+extern int sys_cpustat(void);
+extern int sys_set_starving_threshold(void);
+extern int sys_waitpid(void);
+extern int sys_set_sched_params(void);
+extern int sys_set_affinity(void);
+extern int sys_get_affinity(void);
+extern int sys_set_quantum(void);
+extern int sys_procstat(void);
+extern int sys_getprocs(void);
+extern int sys_lockbench(void);
+extern int sys_set_deadline(void);
+extern int sys_clone(void);
+extern int sys_join(void);
+extern int sys_futex_wait(void);
+extern int sys_futex_wake(void);
+extern int sys_sem_open(void);
+extern int sys_sem_close(void);
+extern int sys_sem_tryacquire(void);
+extern int sys_sem_timedacquire(void);
+extern int sys_set_inheritance(void);
+extern int sys_lockstat(void);
+extern int sys_set_tracing(void);
+extern int sys_sysstat(void);
+extern int sys_set_sysstat(void);
 
 
 static int (*syscalls[])(void) = {
@@ -151,18 +186,46 @@ static int (*syscalls[])(void) = {
 [SYS_sem_init]                  sys_sem_init,
 [SYS_sem_acquire]               sys_sem_acquire,
 [SYS_sem_release]               sys_sem_release,
+[SYS_cpustat]                   sys_cpustat,
+[SYS_set_starving_threshold]    sys_set_starving_threshold,
+[SYS_waitpid]                   sys_waitpid,
+[SYS_set_sched_params]          sys_set_sched_params,
+[SYS_set_affinity]              sys_set_affinity,
+[SYS_get_affinity]              sys_get_affinity,
+[SYS_set_quantum]               sys_set_quantum,
+[SYS_procstat]                  sys_procstat,
+[SYS_getprocs]                  sys_getprocs,
+[SYS_lockbench]                 sys_lockbench,
+[SYS_set_deadline]              sys_set_deadline,
+[SYS_clone]                     sys_clone,
+[SYS_join]                      sys_join,
+[SYS_futex_wait]                sys_futex_wait,
+[SYS_futex_wake]                sys_futex_wake,
+[SYS_sem_open]                  sys_sem_open,
+[SYS_sem_close]                 sys_sem_close,
+[SYS_sem_tryacquire]            sys_sem_tryacquire,
+[SYS_sem_timedacquire]          sys_sem_timedacquire,
+[SYS_set_inheritance]           sys_set_inheritance,
+[SYS_lockstat]                  sys_lockstat,
+[SYS_set_tracing]               sys_set_tracing,
+[SYS_sysstat]                   sys_sysstat,
+[SYS_set_sysstat]               sys_set_sysstat,
 };
 
 void
 syscall(void)
 {
-  int num;
+  int num, ret;
+  uint64 start;
   struct proc *curproc = myproc();
 
   num = curproc->tf->eax;
   if(num > 0 && num < NELEM(syscalls) && syscalls[num]) {
-    push_pid_in_stack(curproc->pid, num);
-    curproc->tf->eax = syscalls[num]();
+    start = rdtsc();
+    ret = syscalls[num]();
+    curproc->tf->eax = ret;
+    sysstat_record(num, start);
+    trace_syscall(curproc->pid, num, ret);
   } else {
     cprintf("%d %s: unknown sys call %d\n",
             curproc->pid, curproc->name, num);
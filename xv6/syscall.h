@@ -32,3 +32,27 @@
 #define SYS_sem_init                   31
 #define SYS_sem_acquire                32
 #define SYS_sem_release                33
+#define SYS_cpustat                    34
+#define SYS_set_starving_threshold     35
+#define SYS_waitpid                    36
+#define SYS_set_sched_params           37
+#define SYS_set_affinity               38
+#define SYS_get_affinity               39
+#define SYS_set_quantum                40
+#define SYS_procstat                   41
+#define SYS_getprocs                   42
+#define SYS_lockbench                  43
+#define SYS_set_deadline               44
+#define SYS_clone                      45
+#define SYS_join                       46
+#define SYS_futex_wait                 47
+#define SYS_futex_wake                 48
+#define SYS_sem_open                   49
+#define SYS_sem_close                  50
+#define SYS_sem_tryacquire             51
+#define SYS_sem_timedacquire           52
+#define SYS_set_inheritance            53
+#define SYS_lockstat                   54
+#define SYS_set_tracing                55
+#define SYS_sysstat                    56
+#define SYS_set_sysstat                57
@@ -0,0 +1,68 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "syscall.h"
+#include "traps.h"
+#include "x86.h"
+
+#define N 100000
+
+// getpid() through the old INT T_SYSCALL path.
+static int
+int_getpid(void)
+{
+  int pid;
+
+  asm volatile("int %2" : "=a" (pid) : "a" (SYS_getpid), "n" (T_SYSCALL)
+               : "memory");
+  return pid;
+}
+
+// usage: syscallbench [iterations]
+// Prints the average cost, in TSC cycles, of a null system
+// call entered with sysenter, as usys.S does, and with int,
+// and of uptime() read from the kernel info page.
+int
+main(int argc, char *argv[])
+{
+  uint64 t0, t1;
+  uint fast, slow, page;
+  int i, n;
+
+  n = argc > 1 ? atoi(argv[1]) : N;
+  if(n <= 0 || n > 1000000){
+    printf(2, "usage: syscallbench [iterations <= 1000000]\n");
+    exit();
+  }
+
+  if(getpid_syscall() != int_getpid()){
+    printf(2, "syscallbench: getpid paths disagree\n");
+    exit();
+  }
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    getpid_syscall();
+  t1 = rdtsc();
+  fast = (uint)(t1 - t0) / n;
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    int_getpid();
+  t1 = rdtsc();
+  slow = (uint)(t1 - t0) / n;
+
+  t0 = rdtsc();
+  for(i = 0; i < n; i++)
+    uptime();
+  t1 = rdtsc();
+  page = (uint)(t1 - t0) / n;
+
+  printf(1, "sysenter: %d cycles\n", fast);
+  printf(1, "int:      %d cycles\n", slow);
+  if(fast > 0)
+    printf(1, "speedup:  %d.%d%dx\n", slow / fast,
+           slow * 10 / fast % 10, slow * 100 / fast % 10);
+  printf(1, "uptime from kinfo page: %d cycles\n", page);
+  exit();
+}
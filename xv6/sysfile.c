@@ -9,60 +9,103 @@
 #include "param.h"
 #include "stat.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "fs.h"
-#include "spinlock.h"
 #include "sleeplock.h"
 #include "file.h"
 #include "fcntl.h"
 
 // Fetch the nth word-sized system call argument as a file descriptor
 // and return both the descriptor and the corresponding struct file.
+// If the descriptor table is shared with other threads, one of them
+// could close fd meanwhile, so a reference to the file is taken and
+// *pref set; the caller must then drop it with fdput(). A leader's
+// nthreads only changes in its own clone() and join(), so a leader
+// that sees none has the table to itself.
 static int
-argfd(int n, int *pfd, struct file **pf)
+argfd(int n, int *pfd, struct file **pf, int *pref)
 {
   int fd;
   struct file *f;
+  struct proc *p = myproc();
+  struct proc *leader = p->leader;
 
-  if(argint(n, &fd) < 0)
+  if(argint(n, &fd) < 0 || fd < 0 || fd >= NOFILE)
     return -1;
-  if(fd < 0 || fd >= NOFILE || (f=myproc()->ofile[fd]) == 0)
+  acquire(&leader->tlock);
+  *pref = 0;
+  if((f=leader->ofile[fd]) != 0 && (leader != p || leader->nthreads > 0)){
+    filedup(f);
+    *pref = 1;
+  }
+  release(&leader->tlock);
+  if(f == 0)
     return -1;
   if(pfd)
     *pfd = fd;
-  if(pf)
-    *pf = f;
+  *pf = f;
   return 0;
 }
 
+// Drop the reference argfd() took, if it took one.
+static void
+fdput(struct file *f, int ref)
+{
+  if(ref)
+    fileclose(f);
+}
+
 // Allocate a file descriptor for the given file.
 // Takes over file reference from caller on success.
+// Threads share their leader's descriptors.
 static int
 fdalloc(struct file *f)
 {
   int fd;
-  struct proc *curproc = myproc();
+  struct proc *leader = myproc()->leader;
 
+  acquire(&leader->tlock);
   for(fd = 0; fd < NOFILE; fd++){
-    if(curproc->ofile[fd] == 0){
-      curproc->ofile[fd] = f;
+    if(leader->ofile[fd] == 0){
+      leader->ofile[fd] = f;
+      release(&leader->tlock);
       return fd;
     }
   }
+  release(&leader->tlock);
   return -1;
 }
 
+// Free descriptor fd if it still refers to f, so that two
+// threads closing it cannot both close f.
+static int
+fdfree(int fd, struct file *f)
+{
+  struct proc *leader = myproc()->leader;
+  int ok;
+
+  acquire(&leader->tlock);
+  if((ok = leader->ofile[fd] == f))
+    leader->ofile[fd] = 0;
+  release(&leader->tlock);
+  return ok ? 0 : -1;
+}
+
 int
 sys_dup(void)
 {
   struct file *f;
-  int fd;
+  int fd, ref;
 
-  if(argfd(0, 0, &f) < 0)
+  if(argfd(0, 0, &f, &ref) < 0)
     return -1;
-  if((fd=fdalloc(f)) < 0)
+  if(!ref)
+    filedup(f);
+  if((fd=fdalloc(f)) < 0){
+    fileclose(f);
     return -1;
-  filedup(f);
+  }
   return fd;
 }
 
@@ -70,36 +113,48 @@ int
 sys_read(void)
 {
   struct file *f;
-  int n;
+  int n, r, ref;
   char *p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f, &ref) < 0)
     return -1;
-  return fileread(f, p, n);
+  r = -1;
+  if(argint(2, &n) >= 0 && argptr(1, &p, n) >= 0)
+    r = fileread(f, p, n);
+  fdput(f, ref);
+  return r;
 }
 
 int
 sys_write(void)
 {
   struct file *f;
-  int n;
+  int n, r, ref;
   char *p;
 
-  if(argfd(0, 0, &f) < 0 || argint(2, &n) < 0 || argptr(1, &p, n) < 0)
+  if(argfd(0, 0, &f, &ref) < 0)
     return -1;
-  return filewrite(f, p, n);
+  r = -1;
+  if(argint(2, &n) >= 0 && argptr(1, &p, n) >= 0)
+    r = filewrite(f, p, n);
+  fdput(f, ref);
+  return r;
 }
 
 int
 sys_close(void)
 {
-  int fd;
+  int fd, ref;
   struct file *f;
 
-  if(argfd(0, &fd, &f) < 0)
+  if(argfd(0, &fd, &f, &ref) < 0)
     return -1;
-  myproc()->ofile[fd] = 0;
-  fileclose(f);
+  if(fdfree(fd, f) < 0){
+    fdput(f, ref);
+    return -1;
+  }
+  fileclose(f);  // the descriptor's reference
+  fdput(f, ref);
   return 0;
 }
 
@@ -108,10 +163,15 @@ sys_fstat(void)
 {
   struct file *f;
   struct stat *st;
+  int r, ref;
 
-  if(argfd(0, 0, &f) < 0 || argptr(1, (void*)&st, sizeof(*st)) < 0)
+  if(argfd(0, 0, &f, &ref) < 0)
     return -1;
-  return filestat(f, st);
+  r = -1;
+  if(argptr(1, (void*)&st, sizeof(*st)) >= 0)
+    r = filestat(f, st);
+  fdput(f, ref);
+  return r;
 }
 
 // Create the path new as a link to the same inode as old.
@@ -433,7 +493,7 @@ sys_pipe(void)
   fd0 = -1;
   if((fd0 = fdalloc(rf)) < 0 || (fd1 = fdalloc(wf)) < 0){
     if(fd0 >= 0)
-      myproc()->ofile[fd0] = 0;
+      fdfree(fd0, rf);
     fileclose(rf);
     fileclose(wf);
     return -1;
@@ -5,7 +5,9 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
+#include "sched.h"
 
 int
 sys_fork(void)
@@ -26,6 +28,16 @@ sys_wait(void)
   return wait();
 }
 
+int
+sys_waitpid(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return waitpid(pid);
+}
+
 int
 sys_kill(void)
 {
@@ -50,8 +62,7 @@ sys_sbrk(void)
 
   if(argint(0, &n) < 0)
     return -1;
-  addr = myproc()->sz;
-  if(growproc(n) < 0)
+  if((addr = growproc(n)) < 0)
     return -1;
   return addr;
 }
@@ -100,21 +111,27 @@ sys_get_parent_pid(void)
 int
 sys_find_largest_prime_factor(void)
 {
-  int number = myproc()->tf->ebx;
+  int number;
+
+  if(argint(0, &number) < 0)
+    return -1;
   cprintf("Kernel: sys_find_largest_prime_factor(%d) is called\n", number);
   cprintf("        now calling find_largest_prime_factor(%d)\n", number);
   return find_largest_prime_factor(number);
 }
 
 // SYSCALL to get callers pids
-void
+int
 sys_get_callers(void)
 {
   int number;
-  argint(0, &number);
+
+  if(argint(0, &number) < 0 || number <= 0 || number >= NSYSCALL)
+    return -1;
   cprintf("Kernel: sys_get_callers(%d) is called\n", number);
   cprintf("        now calling get_callers(%d)\n", number);
   get_callers(number);
+  return 0;
 }
 
 void
@@ -162,30 +179,283 @@ sys_print_all_procs(void)
   print_all_procs();
 }
 
-void
+int
 sys_sem_init(void) 
 {
   int i, v;
-  argint(0, &i);
-  argint(1, &v);
 
-  sem_init(i, v);
+  if(argint(0, &i) < 0 || argint(1, &v) < 0)
+    return -1;
+  return sem_init(i, v);
 }
 
-void
+int
 sys_sem_acquire(void)
 {
   int i;
-  argint(0, &i);
-    
-  sem_acquire(i);
+
+  if(argint(0, &i) < 0)
+    return -1;
+  return sem_acquire(i);
 }
 
-void
+int
 sys_sem_release(void)
 { 
   int i;
-  argint(0, &i);
-    
-  sem_release(i);
-}
\ No newline at end of file
+
+  if(argint(0, &i) < 0)
+    return -1;
+  return sem_release(i);
+}
+
+int
+sys_cpustat(void)
+{
+  struct cpustat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NCPU)
+    return -1;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return cpustat(st, n);
+}
+
+int
+sys_set_starving_threshold(void)
+{
+  int threshold;
+
+  if(argint(0, &threshold) < 0)
+    return -1;
+  return set_starving_threshold(threshold);
+}
+
+int
+sys_set_sched_params(void)
+{
+  struct sched_param *sp;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NPROC)
+    return -1;
+  if(argptr(0, (void*)&sp, n*sizeof(*sp)) < 0)
+    return -1;
+  return set_sched_params(sp, n);
+}
+
+int
+sys_set_affinity(void)
+{
+  int pid, mask;
+
+  if(argint(0, &pid) < 0 || argint(1, &mask) < 0)
+    return -1;
+  return set_affinity(pid, mask);
+}
+
+int
+sys_get_affinity(void)
+{
+  int pid;
+
+  if(argint(0, &pid) < 0)
+    return -1;
+  return get_affinity(pid);
+}
+
+int
+sys_set_quantum(void)
+{
+  int queue, slice, demotes;
+
+  if(argint(0, &queue) < 0 || argint(1, &slice) < 0 || argint(2, &demotes) < 0)
+    return -1;
+  return set_quantum(queue, slice, demotes);
+}
+
+int
+sys_procstat(void)
+{
+  struct procstat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NPROC)
+    return -1;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return procstat(st, n);
+}
+
+int
+sys_getprocs(void)
+{
+  struct procinfo *buf;
+  int max;
+
+  if(argint(1, &max) < 0 || max < 0 || max > NPROC)
+    return -1;
+  if(argptr(0, (void*)&buf, max*sizeof(*buf)) < 0)
+    return -1;
+  return getprocs(buf, max);
+}
+
+int
+sys_lockbench(void)
+{
+  int n;
+
+  if(argint(0, &n) < 0)
+    return -1;
+  return lockbench(n);
+}
+
+int
+sys_set_deadline(void)
+{
+  int pid, period, runtime;
+
+  if(argint(0, &pid) < 0 || argint(1, &period) < 0 || argint(2, &runtime) < 0)
+    return -1;
+  return set_deadline(pid, period, runtime);
+}
+
+int
+sys_clone(void)
+{
+  int fn, arg, stack;
+
+  if(argint(0, &fn) < 0 || argint(1, &arg) < 0 || argint(2, &stack) < 0)
+    return -1;
+  return clone((void (*)(void*))fn, (void*)arg, (void*)stack);
+}
+
+int
+sys_join(void)
+{
+  void **stack;
+
+  if(argptr(0, (void*)&stack, sizeof(*stack)) < 0)
+    return -1;
+  return join(stack);
+}
+
+int
+sys_futex_wait(void)
+{
+  uint *uaddr;
+  int val;
+
+  if(argptr(0, (void*)&uaddr, sizeof(*uaddr)) < 0 || argint(1, &val) < 0)
+    return -1;
+  return futex_wait(uaddr, val);
+}
+
+int
+sys_futex_wake(void)
+{
+  uint *uaddr;
+  int n;
+
+  if(argptr(0, (void*)&uaddr, sizeof(*uaddr)) < 0 || argint(1, &n) < 0)
+    return -1;
+  return futex_wake(uaddr, n);
+}
+
+int
+sys_sem_open(void)
+{
+  char *name;
+  int v;
+
+  if(argstr(0, &name) < 0 || argint(1, &v) < 0)
+    return -1;
+  return sem_open(name, v);
+}
+
+int
+sys_sem_close(void)
+{
+  int i;
+
+  if(argint(0, &i) < 0)
+    return -1;
+  return sem_close(i);
+}
+
+int
+sys_sem_tryacquire(void)
+{
+  int i;
+
+  if(argint(0, &i) < 0)
+    return -1;
+  return sem_tryacquire(i);
+}
+
+int
+sys_sem_timedacquire(void)
+{
+  int i, n;
+
+  if(argint(0, &i) < 0 || argint(1, &n) < 0)
+    return -1;
+  return sem_timedacquire(i, n);
+}
+
+int
+sys_set_inheritance(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return set_inheritance(on);
+}
+
+int
+sys_lockstat(void)
+{
+  struct lockstat *st;
+  int n, reset;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NLOCKSTAT || argint(2, &reset) < 0)
+    return -1;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return lockstat(st, n, reset);
+}
+
+int
+sys_set_tracing(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return set_tracing(on);
+}
+
+int
+sys_sysstat(void)
+{
+  struct sysstat *st;
+  int n;
+
+  if(argint(1, &n) < 0 || n < 0 || n > NSYSCALL)
+    return -1;
+  if(argptr(0, (void*)&st, n*sizeof(*st)) < 0)
+    return -1;
+  return sysstat(st, n);
+}
+
+int
+sys_set_sysstat(void)
+{
+  int on;
+
+  if(argint(0, &on) < 0)
+    return -1;
+  return set_sysstat(on);
+}
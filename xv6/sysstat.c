@@ -0,0 +1,118 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "param.h"
+#include "sched.h"
+#include "syscall.h"
+
+static char *names[NSYSCALL] = {
+[SYS_fork]                      "fork",
+[SYS_exit]                      "exit",
+[SYS_wait]                      "wait",
+[SYS_pipe]                      "pipe",
+[SYS_read]                      "read",
+[SYS_kill]                      "kill",
+[SYS_exec]                      "exec",
+[SYS_fstat]                     "fstat",
+[SYS_chdir]                     "chdir",
+[SYS_dup]                       "dup",
+[SYS_getpid]                    "getpid",
+[SYS_sbrk]                      "sbrk",
+[SYS_sleep]                     "sleep",
+[SYS_uptime]                    "uptime",
+[SYS_open]                      "open",
+[SYS_write]                     "write",
+[SYS_mknod]                     "mknod",
+[SYS_unlink]                    "unlink",
+[SYS_link]                      "link",
+[SYS_mkdir]                     "mkdir",
+[SYS_close]                     "close",
+[SYS_find_largest_prime_factor] "find_largest_prime_factor",
+[SYS_get_callers]               "get_callers",
+[SYS_change_file_size]          "change_file_size",
+[SYS_get_parent_pid]            "get_parent_pid",
+[SYS_set_proc_queue]            "set_proc_queue",
+[SYS_set_lottery_params]        "set_lottery_params",
+[SYS_set_a_proc_bjf_params]     "set_a_proc_bjf_params",
+[SYS_set_all_bjf_params]        "set_all_bjf_params",
+[SYS_print_all_procs]           "print_all_procs",
+[SYS_sem_init]                  "sem_init",
+[SYS_sem_acquire]               "sem_acquire",
+[SYS_sem_release]               "sem_release",
+[SYS_cpustat]                   "cpustat",
+[SYS_set_starving_threshold]    "set_starving_threshold",
+[SYS_waitpid]                   "waitpid",
+[SYS_set_sched_params]          "set_sched_params",
+[SYS_set_affinity]              "set_affinity",
+[SYS_get_affinity]              "get_affinity",
+[SYS_set_quantum]               "set_quantum",
+[SYS_procstat]                  "procstat",
+[SYS_getprocs]                  "getprocs",
+[SYS_lockbench]                 "lockbench",
+[SYS_set_deadline]              "set_deadline",
+[SYS_clone]                     "clone",
+[SYS_join]                      "join",
+[SYS_futex_wait]                "futex_wait",
+[SYS_futex_wake]                "futex_wake",
+[SYS_sem_open]                  "sem_open",
+[SYS_sem_close]                 "sem_close",
+[SYS_sem_tryacquire]            "sem_tryacquire",
+[SYS_sem_timedacquire]          "sem_timedacquire",
+[SYS_set_inheritance]           "set_inheritance",
+[SYS_lockstat]                  "lockstat",
+[SYS_set_tracing]               "set_tracing",
+[SYS_sysstat]                   "sysstat",
+[SYS_set_sysstat]               "set_sysstat",
+};
+
+// total / n, without the 64-bit division libgcc would do
+static uint
+average(uint64 total, uint n)
+{
+  while((total >> 32) && n > 1){
+    total >>= 1;
+    n >>= 1;
+  }
+  return (uint)total / n;
+}
+
+// usage: sysstat [syscall number]
+// print the count and average latency of every syscall
+// called so far, or the latency histogram of one
+int
+main(int argc, char *argv[])
+{
+  struct sysstat *st;
+  int i, b, n, num;
+
+  num = argc > 1 ? atoi(argv[1]) : 0;
+  if(argc > 2 || num < 0 || num >= NSYSCALL){
+    printf(2, "usage: sysstat [syscall number]\n");
+    exit();
+  }
+
+  st = malloc(NSYSCALL * sizeof(*st));
+  n = sysstat(st, NSYSCALL);
+  if(n < 0){
+    printf(2, "sysstat: failed\n");
+    exit();
+  }
+
+  if(num == 0)
+    printf(1, "num  name                     count       avg_cycles\n");
+  for(i = 0; i < n; i++){
+    if(num == 0)
+      printf(1, "%d    %s        %d        %d\n", st[i].num,
+             names[st[i].num] ? names[st[i].num] : "?", st[i].count,
+             average(st[i].cycles, st[i].count));
+    else if(st[i].num == num){
+      printf(1, "%s: %d calls, latency (cycles):\n",
+             names[num] ? names[num] : "?", st[i].count);
+      for(b = 0; b < NLATBUCKET; b++)
+        if(st[i].lat[b])
+          printf(1, "  >= 2^%d: %d\n", b, st[i].lat[b]);
+    }
+  }
+  free(st);
+  exit();
+}
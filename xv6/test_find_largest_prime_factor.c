@@ -12,19 +12,9 @@ int main(int argc, char *argv[]) {
         printf(2, "Error in syntax; please call like:\n>> test_bpf <number>\n");
         exit();
     }
-    int n = atoi(argv[1]), prev_ebx;
-    asm volatile(
-            "movl %%ebx, %0;"
-            "movl %1, %%ebx;"
-            : "=r" (prev_ebx)
-            : "r"(n)
-            );
+    int n = atoi(argv[1]);
     printf(1, "calling find_largest_prime_factor(%d)...\n", n);
-    int result = find_largest_prime_factor();
-    asm volatile(
-            "movl %0, %%ebx;"
-            : : "r"(prev_ebx)
-            );
+    int result = find_largest_prime_factor(n);
     if (result == -1) {
         write(1, "find_largest_prime_factor () failed!\n", 37);
         write(1, "please check i you entered an integer bigger than 1\n", 52);
@@ -0,0 +1,88 @@
+#include "types.h"
+#include "fcntl.h"
+#include "user.h"
+
+#define SEM 0
+#define NMEDIUM 3
+#define WORK 20000000    // loop iterations the low process holds the semaphore for
+#define THRESHOLD 300    // starving threshold during the test, in ticks
+
+// simple program to reproduce priority inversion: a BJF
+// process holds a semaphore a round robin process wants,
+// while lottery processes keep the CPU busy. Prints how
+// long the round robin process waited, without and with
+// priority inheritance. Everything runs on CPU 0.
+static void
+spin(int n)
+{
+  volatile int i;
+
+  for (i = 0; i < n; i++)
+    ;
+}
+
+static int
+inversion(int inherit)
+{
+  int low, medium[NMEDIUM], i, start, waited;
+
+  set_inheritance(inherit);
+  sem_init(SEM, 1);
+
+  low = fork();
+  if (low == 0) {
+    set_proc_queue(getpid(), 3);
+    sem_acquire(SEM);
+    spin(WORK);
+    sem_release(SEM);
+    exit();
+  }
+  sleep(2);  // let it take the semaphore
+
+  for (i = 0; i < NMEDIUM; i++) {
+    medium[i] = fork();
+    if (medium[i] == 0) {
+      set_proc_queue(getpid(), 2);
+      for (;;)
+        spin(WORK);
+    }
+  }
+  sleep(2);
+
+  start = uptime();
+  sem_acquire(SEM);
+  waited = uptime() - start;
+  sem_release(SEM);
+
+  for (i = 0; i < NMEDIUM; i++)
+    kill(medium[i]);
+  while (wait() >= 0)
+    ;
+  return waited;
+}
+
+int main(int argc, char *argv[]) {
+    int without, with, was;
+
+    printf(1, "testing priority inheritance\n");
+
+    set_affinity(getpid(), 1);
+    set_proc_queue(getpid(), 1);
+    set_quantum(2, -1, 0);  // keep the lottery processes on their level
+    set_starving_threshold(THRESHOLD);
+    was = set_inheritance(0);
+
+    without = inversion(0);
+    with = inversion(1);
+
+    set_inheritance(was);
+    set_starving_threshold(8000);
+    set_quantum(2, -1, 1);
+
+    printf(1, "waited %d ticks without inheritance, %d ticks with\n", without, with);
+    if (with < without)
+        printf(1, "priority inheritance test passed\n");
+    else
+        printf(1, "priority inheritance test failed\n");
+    exit();
+}
@@ -0,0 +1,39 @@
+#include "types.h"
+#include "fcntl.h"
+#include "user.h"
+
+#define NCHILD 3
+
+// simple program to test waitpid() system call:
+// reaps the children in the reverse order they were forked
+int main(int argc, char *argv[]) {
+    int pids[NCHILD];
+    int i, pid;
+
+    printf(1, "testing waitpid system call\n");
+
+    for (i = 0; i < NCHILD; i++) {
+        pid = fork();
+        if (pid == 0) {
+            sleep(10 * (i + 1));
+            exit();
+        }
+        pids[i] = pid;
+    }
+
+    for (i = NCHILD - 1; i >= 0; i--) {
+        pid = waitpid(pids[i]);
+        if (pid != pids[i])
+            printf(1, "waitpid(%d) failed: got %d\n", pids[i], pid);
+        else
+            printf(1, "reaped child %d\n", pid);
+    }
+
+    if (waitpid(getpid()) != -1)
+        printf(1, "waitpid on a non-child should fail\n");
+    if (wait() != -1)
+        printf(1, "wait with no children left should fail\n");
+
+    printf(1, "waitpid test done\n");
+    exit();
+}
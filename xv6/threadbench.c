@@ -0,0 +1,87 @@
+#include "types.h"
+#include "stat.h"
+#include "user.h"
+#include "uthread.h"
+
+#define MAXTHREAD 8
+#define LIMIT 200000
+
+// usage: threadbench [maxthreads [limit]]
+// Counts the primes below limit by trial division, split
+// into equal ranges between 1, 2, ... maxthreads threads
+// that each store their count once in a shared array.
+// Prints the ticks each run took and its speedup over one
+// thread, so runs under different CPUS= can be compared.
+struct range {
+  int lo, hi;
+  int count;
+};
+
+static struct range ranges[MAXTHREAD];
+
+static int
+isprime(int n)
+{
+  int d;
+
+  if(n < 2)
+    return 0;
+  for(d = 2; d * d <= n; d++)
+    if(n % d == 0)
+      return 0;
+  return 1;
+}
+
+static void
+count_primes(void *arg)
+{
+  struct range *r = arg;
+  int n, count;
+
+  // Count locally: the ranges share cache lines.
+  count = 0;
+  for(n = r->lo; n < r->hi; n++)
+    count += isprime(n);
+  r->count = count;
+}
+
+int
+main(int argc, char *argv[])
+{
+  int maxthread, limit, nthread, i, start, elapsed, base, total;
+
+  maxthread = argc > 1 ? atoi(argv[1]) : 4;
+  limit = argc > 2 ? atoi(argv[2]) : LIMIT;
+  if(maxthread <= 0 || maxthread > MAXTHREAD || limit <= 0){
+    printf(2, "usage: threadbench [maxthreads [limit]]\n");
+    exit();
+  }
+
+  base = 0;
+  for(nthread = 1; nthread <= maxthread; nthread++){
+    start = uptime();
+    for(i = 0; i < nthread; i++){
+      ranges[i].lo = (uint)limit * i / nthread;
+      ranges[i].hi = (uint)limit * (i + 1) / nthread;
+      if(i > 0 && thread_create(count_primes, &ranges[i]) < 0){
+        printf(2, "threadbench: thread_create failed\n");
+        exit();
+      }
+    }
+    count_primes(&ranges[0]);
+    while(thread_join() >= 0)
+      ;
+    elapsed = uptime() - start;
+
+    total = 0;
+    for(i = 0; i < nthread; i++)
+      total += ranges[i].count;
+    if(nthread == 1)
+      base = elapsed;
+    printf(1, "%d threads: %d primes in %d ticks", nthread, total, elapsed);
+    if(elapsed > 0)
+      printf(1, ", speedup x%d.%d", base / elapsed, base * 10 / elapsed % 10);
+    printf(1, "\n");
+  }
+  exit();
+}
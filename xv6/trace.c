@@ -0,0 +1,195 @@
+// Syscall tracing. Each CPU keeps the last NTRACE syscalls
+// it ran in its own ring, and a count of calls of each
+// syscall. Only that CPU writes its ring, with interrupts
+// off, so recording a call takes no lock and constant time.
+// Readers on other CPUs check afterwards that what they
+// read was not overwritten meanwhile.
+//
+// Each CPU also keeps a log2 histogram of the latency of
+// each syscall, from dispatch to return, in the same way.
+
+#include "types.h"
+#include "defs.h"
+#include "param.h"
+#include "x86.h"
+#include "mmu.h"
+#include "spinlock.h"
+#include "proc.h"
+#include "sched.h"
+
+#define NTRACE 256  // entries per CPU ring
+#define NPERLINE 11 // callers get_callers prints on a line
+
+struct traceent {
+  uint64 tsc;
+  int pid;
+  int num;  // syscall number
+  int ret;  // what it returned
+};
+
+struct tracering {
+  struct traceent ent[NTRACE];
+  volatile uint head;     // entries ever written; the next goes in head % NTRACE
+  uint count[NSYSCALL];   // calls of each syscall on this CPU
+} traces[NCPU];
+
+static int tracing = 1;
+
+struct syslat {
+  uint64 cycles[NSYSCALL];           // total latency of each syscall
+  uint lat[NSYSCALL][NLATBUCKET];    // bucket i counts [2^i, 2^(i+1)) cycles
+} syslats[NCPU];
+
+static int timing = 1;
+
+// Turn recording on or off. Returns whether it was on.
+int
+set_tracing(int on)
+{
+  int was = tracing;
+
+  tracing = on != 0;
+  return was;
+}
+
+// Record that pid's syscall num returned ret.
+void
+trace_syscall(int pid, int num, int ret)
+{
+  struct tracering *r;
+  struct traceent *e;
+
+  if(!tracing || num >= NSYSCALL)
+    return;
+  pushcli();
+  r = &traces[cpuid()];
+  e = &r->ent[r->head % NTRACE];
+  e->tsc = rdtsc();
+  e->pid = pid;
+  e->num = num;
+  e->ret = ret;
+  r->count[num]++;
+  // Publish the entry before moving head past it.
+  __sync_synchronize();
+  r->head++;
+  popcli();
+}
+
+// Copy entry i of r to e. Returns 0 if it has been
+// overwritten, or was by the time the copy was done.
+static int
+trace_read(struct tracering *r, uint i, struct traceent *e)
+{
+  if(r->head - i > NTRACE)
+    return 0;
+  *e = r->ent[i % NTRACE];
+  __sync_synchronize();
+  return r->head - i <= NTRACE;
+}
+
+// Print the recent callers of syscall num, oldest first,
+// merging the CPUs' rings by time.
+void
+get_callers(int num)
+{
+  uint next[NCPU], total;
+  struct traceent e, best;
+  int c, bestc, n, found;
+
+  total = 0;
+  for(c = 0; c < ncpu; c++){
+    total += traces[c].count[num];
+    next[c] = traces[c].head > NTRACE ? traces[c].head - NTRACE : 0;
+  }
+  if(total == 0){
+    cprintf("this syscall is not called yet!!!\n");
+    return;
+  }
+  cprintf("syscall %d called %d times; recent callers as pid:return value\n",
+          num, total);
+
+  n = 0;
+  for(;;){
+    bestc = -1;
+    for(c = 0; c < ncpu; c++){
+      // Find this ring's next entry for num.
+      found = 0;
+      for(; next[c] < traces[c].head; next[c]++)
+        if(trace_read(&traces[c], next[c], &e) && e.num == num){
+          found = 1;
+          break;
+        }
+      if(found && (bestc < 0 || e.tsc < best.tsc)){
+        best = e;
+        bestc = c;
+      }
+    }
+    if(bestc < 0)
+      break;
+    next[bestc]++;
+    if(n > 0)
+      cprintf(n % NPERLINE == 0 ? " ,\n" : " ,");
+    cprintf("%d:%d", best.pid, best.ret);
+    n++;
+  }
+  cprintf("\n");
+}
+
+// Turn latency recording on or off. Returns whether it was
+// on.
+int
+set_sysstat(int on)
+{
+  int was = timing;
+
+  timing = on != 0;
+  return was;
+}
+
+// Record that syscall num, dispatched at TSC start, has
+// returned.
+void
+sysstat_record(int num, uint64 start)
+{
+  struct syslat *s;
+  uint64 lat;
+  int b;
+
+  if(!timing || num >= NSYSCALL)
+    return;
+  lat = rdtsc() - start;
+  b = (lat >> 32) ? 32 + bsr(lat >> 32) : (uint)lat ? bsr(lat) : 0;
+  if(b >= NLATBUCKET)
+    b = NLATBUCKET - 1;
+  pushcli();
+  s = &syslats[cpuid()];
+  s->cycles[num] += lat;
+  s->lat[num][b]++;
+  popcli();
+}
+
+// Copy the latency of up to n syscalls that have been
+// called to st, summed over the CPUs. Returns the number
+// copied.
+int
+sysstat(struct sysstat *st, int n)
+{
+  struct syslat *s;
+  int num, b, i;
+
+  i = 0;
+  for(num = 1; num < NSYSCALL && i < n; num++){
+    memset(&st[i], 0, sizeof(st[i]));
+    st[i].num = num;
+    for(s = syslats; s < &syslats[ncpu]; s++){
+      st[i].cycles += s->cycles[num];
+      for(b = 0; b < NLATBUCKET; b++){
+        st[i].lat[b] += s->lat[num][b];
+        st[i].count += s->lat[num][b];
+      }
+    }
+    if(st[i].count)
+      i++;
+  }
+  return i;
+}
@@ -3,14 +3,15 @@
 #include "param.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "x86.h"
 #include "traps.h"
-#include "spinlock.h"
 
 // Interrupt descriptor table (shared by all CPUs).
 struct gatedesc idt[256];
 extern uint vectors[];  // in vectors.S: array of 256 entry pointers
+extern void sysenter_entry(void);  // in trapasm.S
 struct spinlock tickslock;
 uint ticks;
 
@@ -32,6 +33,43 @@ idtinit(void)
   lidt(idt, sizeof(idt));
 }
 
+// Point this CPU's sysenter at sysenter_entry in trapasm.S.
+// sysenter takes %cs from MSR_SYSENTER_CS and %ss from the
+// descriptor after it, and sysexit takes the user's from the
+// two after those, which is the order of the GDT. The stack
+// is the current process's kernel stack, set by switchuvm.
+void
+sysenterinit(void)
+{
+  wrmsr(MSR_SYSENTER_CS, SEG_KCODE<<3);
+  wrmsr(MSR_SYSENTER_EIP, (uint)sysenter_entry);
+  wrmsr(MSR_SYSENTER_ESP, 0);
+}
+
+// System calls made with sysenter come here from
+// sysenter_entry, with a trap frame as INT T_SYSCALL would
+// have built except for the user %esp and %eip. The stub in
+// usys.S left them at the top of the user stack, at tf->ebp.
+void
+sysenter_trap(struct trapframe *tf)
+{
+  struct proc *curproc = myproc();
+
+  if(curproc->killed)
+    exit();
+  curproc->tf = tf;
+  if(fetchint(tf->ebp, (int*)&tf->eip) < 0){
+    cprintf("pid %d %s: bad sysenter stack %x\n",
+            curproc->pid, curproc->name, tf->ebp);
+    curproc->killed = 1;
+    exit();
+  }
+  tf->esp = tf->ebp + 4;
+  syscall();
+  if(curproc->killed)
+    exit();
+}
+
 //PAGEBREAK: 41
 void
 trap(struct trapframe *tf)
@@ -51,9 +89,16 @@ trap(struct trapframe *tf)
     if(cpuid() == 0){
       acquire(&tickslock);
       ticks++;
+      kinfo_tick(ticks);
       wakeup(&ticks);
       release(&tickslock);
+      sem_tick();
     }
+    aging_tick();
+    lapiceoi();
+    break;
+  case T_IRQ0 + IRQ_RESCHED:
+    // Only wakes a halted scheduler(); see kick_cpu().
     lapiceoi();
     break;
   case T_IRQ0 + IRQ_IDE:
@@ -100,11 +145,12 @@ trap(struct trapframe *tf)
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
     exit();
 
-  // Force process to give up CPU on clock tick.
+  // Charge the process for the clock tick; it gives up the
+  // CPU when its time slice is used up.
   // If interrupts were on while locks held, would need to check nlock.
   if(myproc() && myproc()->state == RUNNING &&
      tf->trapno == T_IRQ0+IRQ_TIMER)
-    yield();
+    sched_tick();
 
   // Check if the process has been killed since we yielded
   if(myproc() && myproc()->killed && (tf->cs&3) == DPL_USER)
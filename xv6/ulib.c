@@ -3,6 +3,7 @@
 #include "fcntl.h"
 #include "user.h"
 #include "x86.h"
+#include "kinfo.h"
 
 char*
 strcpy(char *s, const char *t)
@@ -104,3 +105,47 @@ memmove(void *vdst, const void *vsrc, int n)
     *dst++ = *src++;
   return vdst;
 }
+
+// These read the kernel info pages (kinfo.h) instead of
+// entering the kernel.
+
+int
+getpid(void)
+{
+  int pid;
+
+  if((pid = ((struct pkinfo*)PKINFO)->pid) == 0)
+    return getpid_syscall();
+  return pid;
+}
+
+int
+uptime(void)
+{
+  return ((struct kinfo*)KINFO)->ticks;
+}
+
+// The CPU the process was last switched in on, or -1 if
+// it has threads.
+int
+getcpu(void)
+{
+  return ((struct pkinfo*)PKINFO)->cpu;
+}
+
+// A consistent copy of the shared page.
+void
+kinfo_read(struct kinfo *k)
+{
+  volatile struct kinfo *kp = (struct kinfo*)KINFO;
+  uint seq;
+
+  do {
+    while((seq = kp->seq) & 1)
+      pause();
+    k->ticks = kp->ticks;
+    k->tsc = kp->tsc;
+    k->tsc_per_tick = kp->tsc_per_tick;
+  } while(kp->seq != seq);
+  k->seq = seq;
+}
@@ -1,10 +1,18 @@
 struct stat;
 struct rtcdate;
+struct cpustat;
+struct sched_param;
+struct procstat;
+struct procinfo;
+struct lockstat;
+struct sysstat;
+struct kinfo;
 
 // system calls
 int fork(void);
 int exit(void) __attribute__((noreturn));
 int wait(void);
+int waitpid(int);
 int pipe(int*);
 int write(int, const void*, int);
 int read(int, void*, int);
@@ -19,11 +27,11 @@ int link(const char*, const char*);
 int mkdir(const char*);
 int chdir(const char*);
 int dup(int);
-int getpid(void);
+int getpid_syscall(void);
 char* sbrk(int);
 int sleep(int);
-int uptime(void);
-int find_largest_prime_factor(void);
+int uptime_syscall(void);
+int find_largest_prime_factor(int);
 int get_callers(int);
 int change_file_size(const char*, int);
 int get_parent_pid(void);
@@ -32,9 +40,32 @@ void set_lottery_params(int, int);
 void set_a_proc_bjf_params(int, int, int, int);
 void set_all_bjf_params(int, int, int);
 void print_all_procs(void);
-void sem_init(int, int);
-void sem_acquire(int);
-void sem_release(int);
+int sem_init(int, int);
+int sem_acquire(int);
+int sem_release(int);
+int cpustat(struct cpustat*, int);
+int set_starving_threshold(int);
+int set_sched_params(struct sched_param*, int);
+int set_affinity(int, int);
+int get_affinity(int);
+int set_quantum(int, int, int);
+int procstat(struct procstat*, int);
+int getprocs(struct procinfo*, int);
+int lockbench(int);
+int set_deadline(int, int, int);
+int clone(void (*)(void*), void*, void*);
+int join(void**);
+int futex_wait(volatile uint*, uint);
+int futex_wake(volatile uint*, int);
+int sem_open(const char*, int);
+int sem_close(int);
+int sem_tryacquire(int);
+int sem_timedacquire(int, int);
+int set_inheritance(int);
+int lockstat(struct lockstat*, int, int);
+int set_tracing(int);
+int sysstat(struct sysstat*, int);
+int set_sysstat(int);
 
 // ulib.c
 int stat(const char*, struct stat*);
@@ -49,6 +80,10 @@ void* memset(void*, int, uint);
 void* malloc(uint);
 void free(void*);
 int atoi(const char*);
+int getpid(void);
+int uptime(void);
+int getcpu(void);
+void kinfo_read(struct kinfo*);
 
 // string.c
 int strncmp(const char*, const char*, uint);
@@ -0,0 +1,160 @@
+#include "types.h"
+#include "user.h"
+#include "x86.h"
+#include "uthread.h"
+
+// Threads. Each runs on a one-page stack from malloc, which
+// also holds what it was asked to run, below anything the
+// thread pushes. Returning from fn ends the thread. malloc
+// is not thread-safe, so create and join threads from one
+// thread.
+#define THREAD_STACK 4096
+
+struct thread_start {
+  void (*fn)(void*);
+  void *arg;
+};
+
+static void
+thread_main(void *a)
+{
+  struct thread_start *ts = a;
+
+  ts->fn(ts->arg);
+  exit();
+}
+
+// Start fn(arg) in a new thread and return its pid, or -1.
+int
+thread_create(void (*fn)(void*), void *arg)
+{
+  struct thread_start *ts;
+  int pid;
+
+  if((ts = malloc(THREAD_STACK)) == 0)
+    return -1;
+  ts->fn = fn;
+  ts->arg = arg;
+  if((pid = clone(thread_main, ts, ts)) < 0)
+    free(ts);
+  return pid;
+}
+
+// Wait for one of this process's threads to end and return
+// its pid, or -1 if there are none.
+int
+thread_join(void)
+{
+  void *stack;
+  int pid;
+
+  if((pid = join(&stack)) >= 0)
+    free(stack);
+  return pid;
+}
+
+// Mutexes. An uncontended lock and unlock are one atomic
+// instruction each; only a thread that finds the mutex held
+// enters the kernel, after marking it contended so that
+// the unlock knows to wake it.
+
+void
+mutex_init(struct mutex *m)
+{
+  m->val = 0;
+}
+
+void
+mutex_lock(struct mutex *m)
+{
+  uint c;
+
+  if((c = cmpxchg(&m->val, 0, 1)) == 0)
+    return;
+  if(c != 2)
+    c = xchg(&m->val, 2);
+  while(c != 0){
+    futex_wait(&m->val, 2);
+    c = xchg(&m->val, 2);
+  }
+}
+
+void
+mutex_unlock(struct mutex *m)
+{
+  if(xchg(&m->val, 0) == 2)
+    futex_wake(&m->val, 1);
+}
+
+// Condition variables. A waiter sleeps only if no signal
+// has bumped seq since it let go of the mutex.
+
+void
+cond_init(struct cond *c)
+{
+  c->seq = 0;
+}
+
+void
+cond_wait(struct cond *c, struct mutex *m)
+{
+  uint seq;
+
+  seq = c->seq;
+  mutex_unlock(m);
+  futex_wait(&c->seq, seq);
+  // Others may be waiting behind us, so take the mutex as
+  // contended.
+  while(xchg(&m->val, 2) != 0)
+    futex_wait(&m->val, 2);
+}
+
+void
+cond_signal(struct cond *c)
+{
+  xadd(&c->seq, 1);
+  futex_wake(&c->seq, 1);
+}
+
+void
+cond_broadcast(struct cond *c)
+{
+  xadd(&c->seq, 1);
+  futex_wake(&c->seq, 0x7fffffff);
+}
+
+// Counting semaphores. The count never goes below zero; a
+// post enters the kernel only if someone may be waiting.
+
+void
+usem_init(struct usem *s, uint val)
+{
+  s->val = val;
+  s->nwait = 0;
+}
+
+void
+usem_wait(struct usem *s)
+{
+  uint v;
+
+  for(;;){
+    v = s->val;
+    if(v > 0){
+      if(cmpxchg(&s->val, v, v - 1) == v)
+        return;
+      continue;
+    }
+    xadd(&s->nwait, 1);
+    futex_wait(&s->val, 0);
+    xadd(&s->nwait, -1);
+  }
+}
+
+void
+usem_post(struct usem *s)
+{
+  xadd(&s->val, 1);
+  if(s->nwait > 0)
+    futex_wake(&s->val, 1);
+}
@@ -0,0 +1,33 @@
+// User-level threads and the locks they share, built on
+// clone/join and futex_wait/futex_wake (see uthread.c).
+// Each lock is one or two words that are zero when
+// unlocked or empty, so a zeroed lock needs no init.
+
+struct mutex {
+  volatile uint val;    // 0 unlocked, 1 locked, 2 locked with waiters
+};
+
+struct cond {
+  volatile uint seq;    // bumped by every signal and broadcast
+};
+
+struct usem {
+  volatile uint val;    // count
+  volatile uint nwait;  // threads in or about to be in futex_wait
+};
+
+int thread_create(void (*)(void*), void*);
+int thread_join(void);
+
+void mutex_init(struct mutex*);
+void mutex_lock(struct mutex*);
+void mutex_unlock(struct mutex*);
+
+void cond_init(struct cond*);
+void cond_wait(struct cond*, struct mutex*);
+void cond_signal(struct cond*);
+void cond_broadcast(struct cond*);
+
+void usem_init(struct usem*, uint);
+void usem_wait(struct usem*);
+void usem_post(struct usem*);
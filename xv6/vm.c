@@ -4,8 +4,10 @@
 #include "x86.h"
 #include "memlayout.h"
 #include "mmu.h"
+#include "spinlock.h"
 #include "proc.h"
 #include "elf.h"
+#include "kinfo.h"
 
 extern char data[];  // defined by kernel.ld
 pde_t *kpgdir;  // for use in scheduler()
@@ -21,12 +23,21 @@ seginit(void)
   // Cannot share a CODE descriptor for both kernel and user
   // because it would have to have DPL_USR, but the CPU forbids
   // an interrupt from CPL=0 to DPL=3.
-  c = &cpus[cpuid()];
+  c = lapiccpu();
   c->gdt[SEG_KCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, 0);
   c->gdt[SEG_KDATA] = SEG(STA_W, 0, 0xffffffff, 0);
   c->gdt[SEG_UCODE] = SEG(STA_X|STA_R, 0, 0xffffffff, DPL_USER);
   c->gdt[SEG_UDATA] = SEG(STA_W, 0, 0xffffffff, DPL_USER);
+
+  // Map cpu-local data at %gs, so that mycpu() and myproc()
+  // are single loads. alltraps reloads %gs on kernel entry.
+  c->gdt[SEG_KCPU] = SEG(STA_W, &c->self, 8, 0);
+
   lgdt(c->gdt, sizeof(c->gdt));
+  loadgs(SEG_KCPU << 3);
+
+  c->self = c;
+  c->proc = 0;
 }
 
 // Return the address of the PTE in page table pgdir
@@ -173,6 +184,7 @@ switchuvm(struct proc *p)
   // forbids I/O instructions (e.g., inb and outb) from user space
   mycpu()->ts.iomb = (ushort) 0xFFFF;
   ltr(SEG_TSS << 3);
+  wrmsr(MSR_SYSENTER_ESP, (uint)p->kstack + KSTACKSIZE);
   lcr3(V2P(p->pgdir));  // switch to process's address space
   popcli();
 }
@@ -224,7 +236,7 @@ allocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   char *mem;
   uint a;
 
-  if(newsz >= KERNBASE)
+  if(newsz > KINFO)
     return 0;
   if(newsz < oldsz)
     return oldsz;
@@ -278,15 +290,41 @@ deallocuvm(pde_t *pgdir, uint oldsz, uint newsz)
   return newsz;
 }
 
+// Map the kernel info pages of kinfo.h read-only into pgdir,
+// allocating p's own page the first time. The pages are not
+// part of p->sz, so copyuvm leaves them out.
+int
+mapkinfo(pde_t *pgdir, struct proc *p)
+{
+  extern struct kinfo *kinfo;
+
+  if(p->pkinfo == 0){
+    if((p->pkinfo = (struct pkinfo*)kalloc()) == 0)
+      return -1;
+    memset(p->pkinfo, 0, PGSIZE);
+  }
+  if(mappages(pgdir, (char*)KINFO, PGSIZE, V2P(kinfo), PTE_U) < 0)
+    return -1;
+  if(mappages(pgdir, (char*)PKINFO, PGSIZE, V2P(p->pkinfo), PTE_U) < 0)
+    return -1;
+  return 0;
+}
+
 // Free a page table and all the physical memory pages
-// in the user part.
+// in the user part. The kernel info pages are unmapped
+// first, since they are not this page table's to free.
 void
 freevm(pde_t *pgdir)
 {
   uint i;
+  pte_t *pte;
 
   if(pgdir == 0)
     panic("freevm: no pgdir");
+  if((pte = walkpgdir(pgdir, (char*)KINFO, 0)) != 0)
+    *pte = 0;
+  if((pte = walkpgdir(pgdir, (char*)PKINFO, 0)) != 0)
+    *pte = 0;
   deallocuvm(pgdir, KERNBASE, 0);
   for(i = 0; i < NPDENTRIES; i++){
     if(pgdir[i] & PTE_P){